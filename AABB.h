@@ -0,0 +1,74 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Axis-aligned bounding box
+*  Used by the BVH to skip objects a ray cannot hit.
+-------------------------------------------------------------*/
+
+#ifndef H_AABB
+#define H_AABB
+#include <glm/glm.hpp>
+#include <math.h>
+
+struct AABB
+{
+	glm::vec3 minPt = glm::vec3(INFINITY);
+	glm::vec3 maxPt = glm::vec3(-INFINITY);
+
+	AABB() {}
+
+	AABB(glm::vec3 lo, glm::vec3 hi) : minPt(lo), maxPt(hi) {}
+
+	void expand(glm::vec3 p)
+	{
+		minPt = glm::min(minPt, p);
+		maxPt = glm::max(maxPt, p);
+	}
+
+	void expand(const AABB& box)
+	{
+		minPt = glm::min(minPt, box.minPt);
+		maxPt = glm::max(maxPt, box.maxPt);
+	}
+
+	glm::vec3 centroid() const
+	{
+		return 0.5f * (minPt + maxPt);
+	}
+
+	bool contains(glm::vec3 p) const
+	{
+		return p.x >= minPt.x && p.y >= minPt.y && p.z >= minPt.z
+			&& p.x <= maxPt.x && p.y <= maxPt.y && p.z <= maxPt.z;
+	}
+
+	float area() const
+	{
+		glm::vec3 d = maxPt - minPt;
+		if (d.x < 0) return 0;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	/**
+	* Slab test. Returns true if the ray p0 + t * dir enters the box before tmax,
+	* writing the entry distance to tnear. invDir is 1 / dir, per component.
+	*/
+	bool intersect(glm::vec3 p0, glm::vec3 invDir, float tmax, float& tnear) const
+	{
+		float t0 = 0;
+		float t1 = tmax;
+		for (int i = 0; i < 3; i++)
+		{
+			float ta = (minPt[i] - p0[i]) * invDir[i];
+			float tb = (maxPt[i] - p0[i]) * invDir[i];
+			if (ta > tb) { float tmp = ta; ta = tb; tb = tmp; }
+			if (ta > t0) t0 = ta;
+			if (tb < t1) t1 = tb;
+			if (t0 > t1) return false;
+		}
+		tnear = t0;
+		return true;
+	}
+};
+
+#endif //!H_AABB
@@ -0,0 +1,59 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Progressive sample accumulator
+-------------------------------------------------------------*/
+
+#include "Accumulator.h"
+#include <math.h>
+
+// Rec. 709 luminance
+static float luminance(glm::vec3 c)
+{
+	return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+}
+
+void Accumulator::reset(int width, int height)
+{
+	width_ = width;
+	height_ = height;
+	stats_.assign((size_t)width * height, PixelStats());
+}
+
+/**
+* Adds one sample to pixel (x, y). Each pixel must only be updated by one
+* thread at a time.
+*/
+void Accumulator::add(int x, int y, glm::vec3 colour)
+{
+	PixelStats& s = stats_[y * width_ + x];
+	float lum = luminance(colour);
+	s.sum += colour;
+	s.lumSum += lum;
+	s.lumSqSum += lum * lum;
+	s.count++;
+}
+
+glm::vec3 Accumulator::mean(int x, int y)
+{
+	PixelStats& s = stats_[y * width_ + x];
+	return s.count > 0 ? s.sum / (float)s.count : glm::vec3(0);
+}
+
+/**
+* Standard error of the pixel's mean luminance: the sample standard
+* deviation over the square root of the sample count.
+*/
+float Accumulator::error(int x, int y)
+{
+	PixelStats& s = stats_[y * width_ + x];
+	if (s.count < 2) return INFINITY;
+	float n = s.count;
+	float variance = (s.lumSqSum - s.lumSum * s.lumSum / n) / (n - 1);
+	return sqrtf(fmaxf(variance, 0) / n);
+}
+
+bool Accumulator::converged(int x, int y, float target, int minSamples)
+{
+	return samples(x, y) >= minSamples && error(x, y) < target;
+}
@@ -0,0 +1,50 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Progressive sample accumulator
+*  Keeps a running sum of the samples taken in each pixel,
+*  along with the first two moments of their luminance, so
+*  the renderer can tell how far each pixel's mean may still
+*  be from the true value and stop sampling it once that is
+*  small enough.
+-------------------------------------------------------------*/
+
+#ifndef H_ACCUMULATOR
+#define H_ACCUMULATOR
+#include <vector>
+#include <glm/glm.hpp>
+
+class Accumulator
+{
+
+private:
+	struct PixelStats
+	{
+		glm::vec3 sum = glm::vec3(0);
+		float lumSum = 0;
+		float lumSqSum = 0;
+		int count = 0;
+	};
+
+	int width_ = 0;
+	int height_ = 0;
+	std::vector<PixelStats> stats_;
+
+public:
+	Accumulator() {}
+
+	void reset(int width, int height);
+
+	void add(int x, int y, glm::vec3 colour);
+
+	glm::vec3 mean(int x, int y);
+
+	int samples(int x, int y) { return stats_[y * width_ + x].count; }
+
+	float error(int x, int y);
+
+	bool converged(int x, int y, float target, int minSamples);
+
+};
+
+#endif //!H_ACCUMULATOR
@@ -0,0 +1,280 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Bounding volume hierarchy
+*  Built top down, splitting each node with the surface area
+*  heuristic evaluated over a fixed number of centroid bins.
+-------------------------------------------------------------*/
+
+#include "BVH.h"
+#include "SceneObject.h"
+
+#define BVH_BINS 12
+#define BVH_LEAF_SIZE 2
+#define BVH_MAX_DEPTH 32
+#define BVH_BOX_PADDING 1.e-3f	//Keeps flat objects (planes) from having zero-thickness boxes
+
+void BVH::build(std::vector<SceneObject*>& objects)
+{
+	objects_ = objects;
+	indices_.clear();
+	nodes_.clear();
+	fitObjects();
+	for (int i = 0; i < (int)objects_.size(); i++)
+	{
+		indices_.push_back(i);
+	}
+
+	BVHNode root;
+	root.first = 0;
+	root.count = objects_.size();
+	nodes_.push_back(root);
+	subdivide(0, 0);
+	builtCost_ = cost();
+}
+
+void BVH::fitObjects()
+{
+	objectBounds_.resize(objects_.size());
+	for (int i = 0; i < (int)objects_.size(); i++)
+	{
+		AABB box = objects_[i]->sweptBounds();
+		box.minPt -= glm::vec3(BVH_BOX_PADDING);
+		box.maxPt += glm::vec3(BVH_BOX_PADDING);
+		objectBounds_[i] = box;
+	}
+}
+
+/**
+* Fits every box to the objects' current bounds, keeping the tree as it is.
+* Children are stored after their parent, so one pass from the back of the
+* node list reaches each node after both of its children. O(n).
+*/
+void BVH::refit()
+{
+	fitObjects();
+	for (int n = (int)nodes_.size() - 1; n >= 0; n--)
+	{
+		BVHNode& node = nodes_[n];
+		AABB bounds;
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++) bounds.expand(objectBounds_[indices_[i]]);
+		}
+		else
+		{
+			bounds.expand(nodes_[node.first].bounds);
+			bounds.expand(nodes_[node.first + 1].bounds);
+		}
+		node.bounds = bounds;
+	}
+}
+
+/**
+* Surface area heuristic cost of the tree: the expected number of boxes and
+* objects a ray through the root is tested against. Refitting keeps it low
+* while objects move a little, and lets it grow as their boxes stretch apart.
+*/
+float BVH::cost()
+{
+	if (nodes_.empty()) return 0;
+	float rootArea = nodes_[0].bounds.area();
+	if (rootArea <= 0) return 0;
+	float total = 0;
+	for (size_t n = 0; n < nodes_.size(); n++)
+	{
+		float tests = nodes_[n].count > 0 ? nodes_[n].count : 1;
+		total += nodes_[n].bounds.area() * tests;
+	}
+	return total / rootArea;
+}
+
+/**
+* Fits the node's box to its objects, then splits it in two at the cheapest
+* of the binned centroid planes along its longest axis, unless no split is
+* cheaper than leaving the node as a leaf.
+*/
+void BVH::subdivide(int node, int depth)
+{
+	int first = nodes_[node].first;
+	int count = nodes_[node].count;
+
+	AABB bounds;
+	AABB centroidBounds;
+	for (int i = first; i < first + count; i++)
+	{
+		bounds.expand(objectBounds_[indices_[i]]);
+		centroidBounds.expand(objectBounds_[indices_[i]].centroid());
+	}
+	nodes_[node].bounds = bounds;
+	if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH) return;
+
+	glm::vec3 extent = centroidBounds.maxPt - centroidBounds.minPt;
+	int axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+	if (extent[axis] <= 0) return;
+
+	AABB binBounds[BVH_BINS];
+	int binCounts[BVH_BINS] = { 0 };
+	float scale = BVH_BINS / extent[axis];
+	auto binOf = [&](int object)
+	{
+		int b = (int)((objectBounds_[object].centroid()[axis] - centroidBounds.minPt[axis]) * scale);
+		return b < 0 ? 0 : (b >= BVH_BINS ? BVH_BINS - 1 : b);
+	};
+	for (int i = first; i < first + count; i++)
+	{
+		int b = binOf(indices_[i]);
+		binCounts[b]++;
+		binBounds[b].expand(objectBounds_[indices_[i]]);
+	}
+
+	// Cost of splitting after bin s, from running sums in each direction
+	float leftArea[BVH_BINS - 1];
+	int leftCount[BVH_BINS - 1];
+	AABB running;
+	int runningCount = 0;
+	for (int s = 0; s < BVH_BINS - 1; s++)
+	{
+		running.expand(binBounds[s]);
+		runningCount += binCounts[s];
+		leftArea[s] = running.area();
+		leftCount[s] = runningCount;
+	}
+	float bestCost = INFINITY;
+	int bestSplit = -1;
+	running = AABB();
+	runningCount = 0;
+	for (int s = BVH_BINS - 1; s > 0; s--)
+	{
+		running.expand(binBounds[s]);
+		runningCount += binCounts[s];
+		if (leftCount[s - 1] == 0 || runningCount == 0) continue;
+		float cost = leftArea[s - 1] * leftCount[s - 1] + running.area() * runningCount;
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = s - 1;
+		}
+	}
+	if (bestSplit < 0 || bestCost >= bounds.area() * count) return;
+
+	// Partition indices so the left child's objects come first
+	int mid = first;
+	for (int i = first; i < first + count; i++)
+	{
+		if (binOf(indices_[i]) <= bestSplit)
+		{
+			int tmp = indices_[i];
+			indices_[i] = indices_[mid];
+			indices_[mid] = tmp;
+			mid++;
+		}
+	}
+
+	int left = nodes_.size();
+	BVHNode leftNode;
+	leftNode.first = first;
+	leftNode.count = mid - first;
+	BVHNode rightNode;
+	rightNode.first = mid;
+	rightNode.count = first + count - mid;
+	nodes_.push_back(leftNode);
+	nodes_.push_back(rightNode);
+	nodes_[node].first = left;
+	nodes_[node].count = 0;
+
+	subdivide(left, depth + 1);
+	subdivide(left + 1, depth + 1);
+}
+
+/**
+* Finds the closest object hit by the ray p0 + t * dir with 0 < t < tmax.
+* Moving objects are placed where they are at shutter time 'time'; their
+* boxes already cover the whole shutter interval.
+* Returns t and writes the object's index (in the list the BVH was built
+* from) to index, or returns -1 if nothing is hit.
+*/
+float BVH::closestHit(glm::vec3 p0, glm::vec3 dir, float tmax, float time, int& index)
+{
+	index = -1;
+	if (nodes_.empty()) return -1;
+
+	glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+	float tmin = tmax;
+	float tnear;
+	int stack[2 * BVH_MAX_DEPTH + 2];
+	int top = 0;
+	if (!nodes_[0].bounds.intersect(p0, invDir, tmin, tnear)) return -1;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const BVHNode& node = nodes_[stack[--top]];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float t = objects_[indices_[i]]->intersectAt(p0, dir, time);
+				if (t > 0 && t < tmin)
+				{
+					tmin = t;
+					index = indices_[i];
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so farther boxes can be culled by tmin
+		float tLeft, tRight;
+		bool hitLeft = nodes_[node.first].bounds.intersect(p0, invDir, tmin, tLeft);
+		bool hitRight = nodes_[node.first + 1].bounds.intersect(p0, invDir, tmin, tRight);
+		if (hitLeft && hitRight)
+		{
+			if (tLeft <= tRight)
+			{
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+			}
+			else
+			{
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+		}
+		else if (hitLeft) stack[top++] = node.first;
+		else if (hitRight) stack[top++] = node.first + 1;
+	}
+
+	return index >= 0 ? tmin : -1;
+}
+
+/**
+* Collects the indices of all objects whose bounding boxes contain p.
+*/
+void BVH::overlapping(glm::vec3 p, std::vector<int>& found)
+{
+	if (nodes_.empty()) return;
+	int stack[2 * BVH_MAX_DEPTH + 2];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const BVHNode& node = nodes_[stack[--top]];
+		if (!node.bounds.contains(p)) continue;
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++) found.push_back(indices_[i]);
+			continue;
+		}
+		stack[top++] = node.first;
+		stack[top++] = node.first + 1;
+	}
+}
+
+AABB BVH::getBounds()
+{
+	if (nodes_.empty()) return AABB();
+	return nodes_[0].bounds;
+}
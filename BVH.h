@@ -0,0 +1,63 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Bounding volume hierarchy
+*  A binary tree of bounding boxes over a list of scene
+*  objects, so a ray only tests the objects whose boxes it
+*  passes through. The scene's BVH is the top level; a Group
+*  holds its own BVH, which acts as a bottom level when the
+*  group is placed in the scene through Instances.
+*  When objects move, refit() updates the boxes in place;
+*  once that has made the tree too costly to trace, it
+*  should be built again.
+-------------------------------------------------------------*/
+
+#ifndef H_BVH
+#define H_BVH
+#include <vector>
+#include <glm/glm.hpp>
+#include "AABB.h"
+
+#define BVH_REBUILD_RATIO 1.5f	//Rebuild once refitting makes the tree this much more costly than when built
+
+class SceneObject;
+
+struct BVHNode
+{
+	AABB bounds;
+	int first = 0;		//Leaf: index of first entry in indices. Inner node: index of left child
+	int count = 0;		//Leaf: number of objects. Inner node: 0
+};
+
+class BVH
+{
+private:
+	std::vector<SceneObject*> objects_;
+	std::vector<AABB> objectBounds_;
+	std::vector<int> indices_;		//Object indices, grouped by leaf
+	std::vector<BVHNode> nodes_;	//Root first; children always come after their parent
+	float builtCost_ = 0;			//cost() right after the last build
+
+	void fitObjects();
+
+	void subdivide(int node, int depth);
+
+public:
+	BVH() {}
+
+	void build(std::vector<SceneObject*>& objects);
+
+	void refit();
+
+	float cost();
+
+	bool needsRebuild() { return cost() > BVH_REBUILD_RATIO * builtCost_; }
+
+	float closestHit(glm::vec3 p0, glm::vec3 dir, float tmax, float time, int& index);
+
+	void overlapping(glm::vec3 p, std::vector<int>& found);
+
+	AABB getBounds();
+};
+
+#endif //!H_BVH
@@ -0,0 +1,81 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The box class
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#include "Box.h"
+#include <math.h>
+
+/**
+* Slab test. Finds where the ray's line enters (tNear) and leaves (tFar)
+* the box, and returns false if the box is missed or behind the ray.
+*/
+bool Box::interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar)
+{
+	tNear = -INFINITY;
+	tFar = INFINITY;
+	for (int i = 0; i < 3; i++)
+	{
+		if (fabs(dir[i]) < 1.e-8)
+		{
+			if (p0[i] < minPt[i] || p0[i] > maxPt[i]) return false;
+			continue;
+		}
+		float inv = 1.0f / dir[i];
+		float t1 = (minPt[i] - p0[i]) * inv;
+		float t2 = (maxPt[i] - p0[i]) * inv;
+		if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+		if (t1 > tNear) tNear = t1;
+		if (t2 < tFar) tFar = t2;
+		if (tNear > tFar) return false;
+	}
+	return tFar > 0.001;
+}
+
+/**
+* Box's intersection method. Returns the entry distance, or the exit
+* distance when the ray starts inside the box.
+*/
+float Box::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+	float tNear, tFar;
+	if (!interval(p0, dir, tNear, tFar)) return -1.0;
+	if (tNear > 0.001) return tNear;
+	if (tFar > 0.001) return tFar;
+	return -1.0;
+}
+
+/**
+* Returns the outward normal of the face closest to p.
+*/
+glm::vec3 Box::normal(glm::vec3 p)
+{
+	glm::vec3 n(0);
+	float best = INFINITY;
+	for (int i = 0; i < 3; i++)
+	{
+		float dMin = fabs(p[i] - minPt[i]);
+		float dMax = fabs(p[i] - maxPt[i]);
+		if (dMin < best)
+		{
+			best = dMin;
+			n = glm::vec3(0);
+			n[i] = -1;
+		}
+		if (dMax < best)
+		{
+			best = dMax;
+			n = glm::vec3(0);
+			n[i] = 1;
+		}
+	}
+	return n;
+}
+
+AABB Box::getBounds()
+{
+	return AABB(minPt, maxPt);
+}
@@ -0,0 +1,40 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The box class
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#ifndef H_BOX
+#define H_BOX
+#include <glm/glm.hpp>
+#include "SceneObject.h"
+
+/**
+ * Defines an axis-aligned box spanning 'minPt' to 'maxPt'.
+ * Boxes in other orientations can be made with an Instance.
+ */
+class Box : public SceneObject
+{
+
+private:
+	glm::vec3 minPt = glm::vec3(0);
+	glm::vec3 maxPt = glm::vec3(1);
+
+public:
+	Box() { this->type_ = BoxObject; }
+
+	Box(glm::vec3 lo, glm::vec3 hi) : minPt(lo), maxPt(hi) { this->type_ = BoxObject; }
+
+	bool interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar);
+
+	float intersect(glm::vec3 p0, glm::vec3 dir);
+
+	glm::vec3 normal(glm::vec3 p);
+
+	AABB getBounds();
+
+};
+
+#endif //!H_BOX
@@ -0,0 +1,191 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Render checkpoints
+*  File layout: a CheckpointHeader, then one record per
+*  finished tile: its index, its colours as floats in host
+*  byte order, and the index again. A record cut short by a
+*  crash fails the length or trailing index check, and is
+*  dropped together with anything after it.
+-------------------------------------------------------------*/
+
+#include "Checkpoint.h"
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+struct CheckpointHeader
+{
+	char magic[4];				//"RTCP"
+	unsigned int version;		//CHECKPOINT_VERSION
+	unsigned long long key;		//checkpointKey() of the render settings
+	int numTiles;
+};
+
+/**
+* FNV-1a over the file version and the settings that decide what the
+* frame's pixels will be.
+*/
+unsigned long long checkpointKey(const int *settings, int numSettings)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned int version = CHECKPOINT_VERSION;
+	const unsigned char *bytes = (const unsigned char *)&version;
+	for (size_t i = 0; i < sizeof(version); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	bytes = (const unsigned char *)settings;
+	for (size_t i = 0; i < numSettings * sizeof(int); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+* Opens the checkpoint at path. Tiles finished by an earlier run with the
+* same key are passed to restore and marked done; a file written for other
+* settings is started over. Returns the number of tiles restored.
+*/
+int Checkpoint::open(const char *path, unsigned long long key, const std::vector<Tile>& frameTiles, TileSink restore)
+{
+	finish(false);
+	path_ = path;
+	tiles = frameTiles;
+	done.assign(tiles.size(), 0);
+	int restored = 0;
+	long goodSize = 0;
+
+	file = fopen(path, "r+b");
+	CheckpointHeader header;
+	if (file != nullptr && fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, "RTCP", 4) == 0 && header.version == CHECKPOINT_VERSION
+		&& header.key == key && header.numTiles == (int)tiles.size())
+	{
+		goodSize = sizeof(header);
+		std::vector<glm::vec3> colours;
+		int index, trailer;
+		while (fread(&index, sizeof(index), 1, file) == 1)
+		{
+			if (index < 0 || index >= (int)tiles.size()) break;
+			colours.resize(tiles[index].numCells());
+			if (fread(colours.data(), sizeof(glm::vec3), colours.size(), file) != colours.size()) break;
+			if (fread(&trailer, sizeof(trailer), 1, file) != 1 || trailer != index) break;
+
+			restore(tiles[index], colours.data());
+			if (!done[index]) restored++;
+			done[index] = 1;
+			goodSize = ftell(file);
+		}
+	}
+
+	if (goodSize == 0)
+	{
+		if (file != nullptr) fclose(file);
+		file = fopen(path, "wb");
+		if (file == nullptr)
+		{
+			std::cerr << "Cannot write checkpoint " << path << std::endl;
+			return 0;
+		}
+		memcpy(header.magic, "RTCP", 4);
+		header.version = CHECKPOINT_VERSION;
+		header.key = key;
+		header.numTiles = tiles.size();
+		fwrite(&header, sizeof(header), 1, file);
+		fflush(file);
+	}
+	else
+	{
+		// Cut off a torn record so new ones follow the last good one
+		fflush(file);
+#ifdef _WIN32
+		_chsize(_fileno(file), goodSize);
+#else
+		if (ftruncate(fileno(file), goodSize) != 0) std::cerr << "Cannot trim checkpoint " << path << std::endl;
+#endif
+		fseek(file, goodSize, SEEK_SET);
+	}
+
+	stopping = false;
+	writer = std::thread(&Checkpoint::writeLoop, this);
+	return restored;
+}
+
+/**
+* Queues a finished tile for writing. Safe to call from any render thread.
+*/
+void Checkpoint::tileDone(int index, const glm::vec3 *colours)
+{
+	if (file == nullptr) return;
+	Record record;
+	record.index = index;
+	record.colours.assign(colours, colours + tiles[index].numCells());
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		queue.push_back(std::move(record));
+	}
+	wake.notify_one();
+}
+
+/**
+* Writes queued tiles in batches, flushing after each batch. Waits up to
+* CHECKPOINT_FLUSH_SECONDS for more to arrive before writing what it has.
+*/
+void Checkpoint::writeLoop()
+{
+	std::deque<Record> batch;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait_for(guard, std::chrono::seconds(CHECKPOINT_FLUSH_SECONDS),
+				[this]() { return stopping || queue.size() >= 16; });
+			batch.swap(queue);
+		}
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			Record& r = batch[i];
+			fwrite(&r.index, sizeof(r.index), 1, file);
+			fwrite(r.colours.data(), sizeof(glm::vec3), r.colours.size(), file);
+			fwrite(&r.index, sizeof(r.index), 1, file);
+		}
+		if (!batch.empty()) fflush(file);
+		batch.clear();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (stopping && queue.empty()) return;
+	}
+}
+
+/**
+* Writes out anything still queued and closes the file. Once the whole frame
+* is done the checkpoint is no longer needed and is deleted.
+*/
+void Checkpoint::finish(bool frameComplete)
+{
+	if (writer.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_one();
+		writer.join();
+	}
+	if (file != nullptr)
+	{
+		fclose(file);
+		file = nullptr;
+		if (frameComplete) remove(path_.c_str());
+	}
+}
@@ -0,0 +1,66 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Render checkpoints
+*  Finished tiles are appended to a file as they complete,
+*  so a run that dies part way through can be restarted and
+*  only render the tiles that are missing. Writes happen on
+*  a background thread; render threads only copy the tile's
+*  colours into a queue.
+-------------------------------------------------------------*/
+
+#ifndef H_CHECKPOINT
+#define H_CHECKPOINT
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Tile.h"
+
+// Bump whenever the file layout changes.
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_FLUSH_SECONDS 5	//Queued tiles reach the file at least this often
+
+unsigned long long checkpointKey(const int *settings, int numSettings);
+
+class Checkpoint
+{
+
+private:
+	struct Record
+	{
+		int index;
+		std::vector<glm::vec3> colours;
+	};
+
+	std::string path_;
+	FILE *file = nullptr;
+	std::vector<Tile> tiles;
+	std::vector<char> done;			//Tiles restored from the file when it was opened
+	std::deque<Record> queue;		//Finished tiles waiting to be written
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread writer;
+	bool stopping = false;
+
+	void writeLoop();
+
+public:
+	Checkpoint() {}
+
+	~Checkpoint() { finish(false); }
+
+	int open(const char *path, unsigned long long key, const std::vector<Tile>& frameTiles, TileSink restore);
+
+	bool isDone(int index) { return index < (int)done.size() && done[index]; }
+
+	void tileDone(int index, const glm::vec3 *colours);
+
+	void finish(bool frameComplete);
+
+};
+
+#endif //!H_CHECKPOINT
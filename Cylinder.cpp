@@ -5,6 +5,16 @@
 using namespace std;
 
 float Cylinder::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+#if FAST_MATH_KERNELS
+    return intersectFast(p0, dir);
+#else
+    return intersectReference(p0, dir);
+#endif
+}
+
+// The original kernel, kept to check intersectFast() against.
+float Cylinder::intersectReference(glm::vec3 p0, glm::vec3 dir)
 {
     glm::vec3 vdif = p0 - center;
 
@@ -26,8 +36,30 @@ float Cylinder::intersect(glm::vec3 p0, glm::vec3 dir)
 
     float t1 = (-b - sqrt(delta)) / (2 * a);
     float t2 = (-b + sqrt(delta)) / (2 * a);
+    return clipRoots(p0, dir, t1, t2);
+}
+
+float Cylinder::intersectFast(glm::vec3 p0, glm::vec3 dir)
+{
+    glm::vec3 vdif = p0 - center;
+    float a = (dir.x * dir.x) + (dir.z * dir.z);
+
+    // Half of b, so the 2s and 4 cancel: delta below is a quarter of the
+    // original one, and so is its threshold.
+    float b = (dir.x * vdif.x) + (dir.z * vdif.z);
+    float c = (vdif.x * vdif.x) + (vdif.z * vdif.z) - (radius * radius);
+
+    float delta = (b * b) - (a * c);
+    if (delta < 0.00025f) return -1.0f;
 
+    float root = sqrtf(delta);
+    float invA = 1.0f / a;
+    return clipRoots(p0, dir, (-b - root) * invA, (-b + root) * invA);
+}
 
+// Keeps the roots that land on the side between base and top, or the top cap.
+float Cylinder::clipRoots(glm::vec3 p0, glm::vec3 dir, float t1, float t2)
+{
     if(fabs(t1) < 0.001 )
     {
         if (t2 > 0) return t2;
@@ -61,4 +93,32 @@ glm::vec3 Cylinder::normal(glm::vec3 p)
     }
 
     return ignoreY;
-}
\ No newline at end of file
+}
+
+/**
+* Cylindrical texture coordinates: u runs around the axis and v from the
+* base (0) to the top (1). On the side the tangents point around the axis
+* and up it; the flat top gets the generic frame.
+*/
+void Cylinder::fillHit(HitRecord& hit)
+{
+    glm::vec3 shifted = hit.position - center;
+    if (shifted.y >= height)
+    {
+        SceneObject::fillHit(hit);
+    }
+    else
+    {
+        hit.normal = glm::vec3(shifted.x / radius, 0, shifted.z / radius);
+        hit.shadingNormal = hit.normal;
+        hit.dpdu = glm::vec3(hit.normal.z, 0, -hit.normal.x);
+        hit.dpdv = glm::vec3(0, 1, 0);
+    }
+    hit.uv = glm::vec2(0.5 + atan2(shifted.x, shifted.z) / (2 * M_PI), shifted.y / height);
+}
+
+AABB Cylinder::getBounds()
+{
+    return AABB(center - glm::vec3(radius, 0, radius),
+        center + glm::vec3(radius, height, radius));
+}
@@ -11,6 +11,8 @@ private:
     float radius = 1;
     float height = 1;
 
+    float clipRoots(glm::vec3 p0, glm::vec3 dir, float t1, float t2);
+
 public:
     Cylinder() { this->type_ = CylinderObject; }
 
@@ -18,6 +20,14 @@ public:
 
     float intersect(glm::vec3 p0, glm::vec3 dir);
 
+    float intersectReference(glm::vec3 p0, glm::vec3 dir);
+
+    float intersectFast(glm::vec3 p0, glm::vec3 dir);
+
     glm::vec3 normal(glm::vec3 p);
+
+    void fillHit(HitRecord& hit);
+
+    AABB getBounds();
 };
 #endif
\ No newline at end of file
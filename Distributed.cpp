@@ -0,0 +1,397 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Distributed rendering
+*  Messages, all integers in network byte order:
+*    worker -> coordinator  hello: magic, frame size, settings
+*                           key (high word, then low word)
+*    coordinator -> worker  tile: index, x0, x1, y0, y1, frame
+*                           (index -1 means no more tiles for
+*                           this frame, -2 that the worker's
+*                           settings do not match)
+*    worker -> coordinator  result: index, then the tile's
+*                           colours as raw floats
+*  Colours are sent as they are in memory, so all machines
+*  taking part must use the same float layout.
+-------------------------------------------------------------*/
+
+#include "Distributed.h"
+#include <iostream>
+
+#ifdef _WIN32
+
+bool runCoordinator(const std::string& address, int frameSize, unsigned long long settingsKey, int frame,
+	const std::vector<Tile>& tiles, TileSink store)
+{
+	std::cerr << "Distributed rendering is not supported on this platform" << std::endl;
+	return false;
+}
+
+bool runWorker(const std::string& address, int frameSize, unsigned long long settingsKey,
+	FrameTileRenderer render)
+{
+	std::cerr << "Distributed rendering is not supported on this platform" << std::endl;
+	return false;
+}
+
+#else
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#define WORKER_MAGIC 0x52545732		//"RTW2"
+#define HELLO_WORDS 4
+#define TILE_WORDS 6
+#define NO_MORE_TILES -1
+#define WRONG_SETTINGS -2
+
+typedef std::chrono::steady_clock Clock;
+
+static bool isUnixAddress(const std::string& address)
+{
+	return address.find('/') != std::string::npos;
+}
+
+static bool sendAll(int fd, const void* data, size_t len)
+{
+	const char* p = (const char*)data;
+	while (len > 0)
+	{
+		ssize_t n = send(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool recvAll(int fd, void* data, size_t len)
+{
+	char* p = (char*)data;
+	while (len > 0)
+	{
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static int listenOn(const std::string& address)
+{
+	int fd;
+	if (isUnixAddress(address))
+	{
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+		unlink(address.c_str());
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) goto failed;
+	}
+	else
+	{
+		size_t colon = address.rfind(':');
+		int port = atoi(address.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		addr.sin_port = htons(port);
+		int on = 1;
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) goto failed;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) goto failed;
+	}
+	if (listen(fd, 64) < 0) goto failed;
+	return fd;
+
+failed:
+	std::cerr << "Cannot listen on " << address << ": " << strerror(errno) << std::endl;
+	if (fd >= 0) close(fd);
+	return -1;
+}
+
+static int connectTo(const std::string& address)
+{
+	if (isUnixAddress(address))
+	{
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+
+	size_t colon = address.rfind(':');
+	std::string host = colon == std::string::npos ? "localhost" : address.substr(0, colon);
+	std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* found;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return -1;
+
+	int fd = -1;
+	for (addrinfo* a = found; a != nullptr; a = a->ai_next)
+	{
+		fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd < 0) continue;
+		if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(found);
+	if (fd >= 0)
+	{
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	return fd;
+}
+
+static size_t tileBytes(const Tile& tile)
+{
+	return (size_t)(tile.x1 - tile.x0) * (tile.y1 - tile.y0) * sizeof(glm::vec3);
+}
+
+/**
+ * A connected worker as seen by the coordinator. Replies are read in
+ * pieces as they arrive, so one slow worker never holds up the others.
+ */
+struct WorkerLink
+{
+	int fd = -1;
+	bool greeted = false;			//Hello received and checked
+	int tile = -1;					//Tile it is rendering, -1 if idle
+	std::vector<char> buffer;		//Reply so far
+	size_t received = 0;
+	Clock::time_point started;
+};
+
+bool runCoordinator(const std::string& address, int frameSize, unsigned long long settingsKey, int frame,
+	const std::vector<Tile>& tiles, TileSink store)
+{
+	signal(SIGPIPE, SIG_IGN);
+	int listener = listenOn(address);
+	if (listener < 0) return false;
+	std::cout << "Coordinating " << tiles.size() << " tiles on " << address << std::endl;
+
+	std::deque<int> pending;
+	for (int i = 0; i < (int)tiles.size(); i++) pending.push_back(i);
+	std::vector<WorkerLink> workers;
+	size_t done = 0;
+	Clock::time_point lastWorker = Clock::now();
+
+	// Drops a worker, putting its tile back at the front of the queue
+	auto drop = [&](WorkerLink& w, const char* reason)
+	{
+		std::cerr << "Worker dropped (" << reason << ")";
+		if (w.tile >= 0)
+		{
+			std::cerr << ", tile " << w.tile << " reassigned";
+			pending.push_front(w.tile);
+		}
+		std::cerr << std::endl;
+		close(w.fd);
+		w.fd = -1;
+	};
+
+	auto assign = [&](WorkerLink& w)
+	{
+		w.tile = -1;
+		if (pending.empty()) return;
+		int index = pending.front();
+		pending.pop_front();
+		const Tile& t = tiles[index];
+		uint32_t msg[TILE_WORDS] = { htonl(index), htonl(t.x0), htonl(t.x1), htonl(t.y0), htonl(t.y1), htonl(frame) };
+		w.tile = index;
+		w.buffer.resize(sizeof(uint32_t) + tileBytes(t));
+		w.received = 0;
+		w.started = Clock::now();
+		if (!sendAll(w.fd, msg, sizeof(msg))) drop(w, "send failed");
+	};
+
+	while (done < tiles.size())
+	{
+		std::vector<pollfd> fds(1 + workers.size());
+		fds[0] = { listener, POLLIN, 0 };
+		for (size_t i = 0; i < workers.size(); i++) fds[i + 1] = { workers[i].fd, POLLIN, 0 };
+		if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) break;
+
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			WorkerLink& w = workers[i];
+			if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+			if (w.greeted && w.tile < 0)
+			{
+				drop(w, "disconnected");		//Idle workers have nothing to send
+				continue;
+			}
+
+			ssize_t n = recv(w.fd, w.buffer.data() + w.received, w.buffer.size() - w.received, MSG_DONTWAIT);
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) continue;
+			if (n <= 0)
+			{
+				drop(w, "disconnected");
+				continue;
+			}
+			w.received += n;
+			if (w.received < w.buffer.size()) continue;
+
+			uint32_t head[HELLO_WORDS];
+			memcpy(head, w.buffer.data(), sizeof(uint32_t) * (w.greeted ? 1 : HELLO_WORDS));
+			if (!w.greeted)
+			{
+				unsigned long long key = (unsigned long long)ntohl(head[2]) << 32 | ntohl(head[3]);
+				if (ntohl(head[0]) != WORKER_MAGIC || (int)ntohl(head[1]) != frameSize || key != settingsKey)
+				{
+					uint32_t reject[TILE_WORDS] = { htonl((uint32_t)WRONG_SETTINGS), 0, 0, 0, 0, 0 };
+					sendAll(w.fd, reject, sizeof(reject));
+					drop(w, "different settings");
+					continue;
+				}
+				w.greeted = true;
+				assign(w);
+				continue;
+			}
+
+			if ((int)ntohl(head[0]) != w.tile)
+			{
+				drop(w, "unexpected tile");
+				continue;
+			}
+			const Tile& t = tiles[w.tile];
+			std::vector<glm::vec3> colours(tileBytes(t) / sizeof(glm::vec3));
+			memcpy(colours.data(), w.buffer.data() + sizeof(uint32_t), tileBytes(t));
+			store(t, colours.data());
+			done++;
+			assign(w);
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			WorkerLink w;
+			w.fd = accept(listener, nullptr, nullptr);
+			if (w.fd >= 0)
+			{
+				w.buffer.resize(HELLO_WORDS * sizeof(uint32_t));
+				workers.push_back(w);
+			}
+		}
+
+		Clock::time_point now = Clock::now();
+		if (!workers.empty()) lastWorker = now;
+		else if (now - lastWorker > std::chrono::seconds(COORDINATOR_IDLE_SECONDS))
+		{
+			std::cerr << "No workers for " << COORDINATOR_IDLE_SECONDS << " s, " << tiles.size() - done
+				<< " tiles left undone" << std::endl;
+			break;
+		}
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			WorkerLink& w = workers[i];
+			if (w.fd < 0) continue;
+			if (w.tile >= 0 && now - w.started > std::chrono::seconds(TILE_TIMEOUT_SECONDS))
+			{
+				drop(w, "timed out");
+			}
+			else if (w.greeted && w.tile < 0)
+			{
+				assign(w);		//Picks up tiles given back by dropped workers
+			}
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			if (workers[i].fd >= 0) workers[kept++] = workers[i];
+		}
+		workers.resize(kept);
+	}
+
+	uint32_t stop[TILE_WORDS] = { htonl((uint32_t)NO_MORE_TILES), 0, 0, 0, 0, 0 };
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		sendAll(workers[i].fd, stop, sizeof(stop));
+		close(workers[i].fd);
+	}
+	close(listener);
+	if (isUnixAddress(address)) unlink(address.c_str());
+	return done == tiles.size();
+}
+
+/**
+* Serves one connection to a coordinator. Returns the index of the message
+* that ended it, or NO_MORE_TILES if the connection was lost.
+*/
+static int serveCoordinator(int fd, int frameSize, unsigned long long settingsKey, FrameTileRenderer render)
+{
+	uint32_t hello[HELLO_WORDS] = { htonl(WORKER_MAGIC), htonl(frameSize),
+		htonl((uint32_t)(settingsKey >> 32)), htonl((uint32_t)settingsKey) };
+	std::vector<glm::vec3> colours;
+	bool ok = sendAll(fd, hello, sizeof(hello));
+	while (ok)
+	{
+		uint32_t msg[TILE_WORDS];
+		if (!recvAll(fd, msg, sizeof(msg))) break;
+		int index = (int)ntohl(msg[0]);
+		if (index < 0) return index;
+
+		Tile t = { (int)ntohl(msg[1]), (int)ntohl(msg[2]), (int)ntohl(msg[3]), (int)ntohl(msg[4]) };
+		colours.resize((t.x1 - t.x0) * (t.y1 - t.y0));
+		render((int)ntohl(msg[5]), t, colours.data());
+
+		uint32_t head = htonl(index);
+		ok = sendAll(fd, &head, sizeof(head)) && sendAll(fd, colours.data(), tileBytes(t));
+	}
+	return NO_MORE_TILES;
+}
+
+bool runWorker(const std::string& address, int frameSize, unsigned long long settingsKey,
+	FrameTileRenderer render)
+{
+	signal(SIGPIPE, SIG_IGN);
+	Clock::time_point lastSeen = Clock::now();
+	static std::atomic<bool> reported(false);		//Said once per process, not per connection
+	while (Clock::now() - lastSeen < std::chrono::seconds(WORKER_IDLE_SECONDS))
+	{
+		int fd = connectTo(address);
+		if (fd < 0)
+		{
+			if (!reported.exchange(true)) std::cerr << "Waiting for coordinator at " << address << std::endl;
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			continue;
+		}
+		int end = serveCoordinator(fd, frameSize, settingsKey, render);
+		close(fd);
+		if (end == WRONG_SETTINGS)
+		{
+			std::cerr << "Coordinator at " << address << " uses different settings" << std::endl;
+			return false;
+		}
+		lastSeen = Clock::now();
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Distributed rendering
+*  A coordinator hands out tiles of the frame to worker
+*  processes over TCP or Unix sockets and collects the
+*  rendered colours. Workers must render with the same scene
+*  and settings as the coordinator: each says hello with a key
+*  of its settings, and is turned away if it differs. Every
+*  tile carries the frame number, so workers follow an
+*  animated coordinator from frame to frame. A worker that
+*  disconnects or stalls has its tile given to another worker.
+*  Workers stay around between frames, connecting again for
+*  the next one until no coordinator has been seen for
+*  WORKER_IDLE_SECONDS.
+*
+*  Addresses are "host:port" (or just "port" for the
+*  coordinator) for TCP, or a path containing '/' for a Unix
+*  socket. Not available on Windows.
+-------------------------------------------------------------*/
+
+#ifndef H_DISTRIBUTED
+#define H_DISTRIBUTED
+#include <string>
+#include <vector>
+#include "Tile.h"
+
+#define TILE_TIMEOUT_SECONDS 120		//A worker holding a tile longer than this is dropped
+#define COORDINATOR_IDLE_SECONDS 10		//The coordinator gives up after this long without any workers
+#define WORKER_IDLE_SECONDS 600			//Workers exit after this long without a coordinator
+
+// Renders a tile of the given frame on a worker. Connections call it from their
+// own threads, and a tile may belong to a frame the coordinator has moved past.
+typedef std::function<void(int frame, const Tile&, glm::vec3*)> FrameTileRenderer;
+
+// Serves the tiles of frame to workers whose settings key matches, passing
+// each result to store, until every tile has come back. Returns false if
+// the address cannot be listened on, or if no worker has been connected for
+// COORDINATOR_IDLE_SECONDS; the tiles not yet stored are then left to the caller.
+bool runCoordinator(const std::string& address, int frameSize, unsigned long long settingsKey, int frame,
+	const std::vector<Tile>& tiles, TileSink store);
+
+// Renders tiles for the coordinator at address, frame after frame. Returns
+// true once no coordinator has been seen for WORKER_IDLE_SECONDS, or false
+// if the coordinator turns the worker away because its settings differ.
+bool runWorker(const std::string& address, int frameSize, unsigned long long settingsKey,
+	FrameTileRenderer render);
+
+#endif //!H_DISTRIBUTED
@@ -0,0 +1,67 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The group class
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#include "Group.h"
+
+/**
+* Closest intersection with any of the group's parts.
+*/
+float Group::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+	int index;
+	return bvh.closestHit(p0, dir, 1.e+6, 0, index);
+}
+
+/**
+* Returns the index of the part that p lies on.
+* intersect() only reports a distance, so the part is found again here:
+* of the parts whose boxes contain p, it is the one that a short probe
+* ray fired back at p along that part's normal hits right at p.
+*/
+int Group::partAt(glm::vec3 p)
+{
+	const float probe = 0.01;
+	std::vector<int> candidates;
+	bvh.overlapping(p, candidates);
+
+	int best = -1;
+	float bestError = INFINITY;
+	for (int i = 0; i < (int)candidates.size(); i++)
+	{
+		SceneObject* part = parts[candidates[i]];
+		glm::vec3 n = part->normal(p);
+		float t = part->intersect(p + probe * n, -n);
+		float error = fabs(t - probe);
+		if (t > 0 && error < bestError)
+		{
+			bestError = error;
+			best = candidates[i];
+		}
+	}
+
+	if (best < 0) best = candidates.empty() ? 0 : candidates[0];
+	return best;
+}
+
+glm::vec3 Group::normal(glm::vec3 p)
+{
+	return parts[partAt(p)]->normal(p);
+}
+
+/**
+* The part is looked up once per hit, and it fills in the rest of the record.
+*/
+void Group::fillHit(HitRecord& hit)
+{
+	parts[partAt(hit.position)]->fillHit(hit);
+}
+
+AABB Group::getBounds()
+{
+	return bvh.getBounds();
+}
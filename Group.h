@@ -0,0 +1,44 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The group class
+*  A collection of objects treated as one piece of geometry,
+*  with its own BVH. Groups are meant to be placed in the
+*  scene through Instances, so one copy of the parts can be
+*  shared by any number of placements.
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#ifndef H_GROUP
+#define H_GROUP
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.h"
+#include "SceneObject.h"
+
+class Group : public SceneObject
+{
+
+private:
+	std::vector<SceneObject*> parts;
+	BVH bvh;
+
+	int partAt(glm::vec3 p);
+
+public:
+	Group() { this->type_ = GroupObject; }
+
+	Group(std::vector<SceneObject*> p) : parts(p) { this->type_ = GroupObject; bvh.build(parts); }
+
+	float intersect(glm::vec3 p0, glm::vec3 dir);
+
+	glm::vec3 normal(glm::vec3 p);
+
+	void fillHit(HitRecord& hit);
+
+	AABB getBounds();
+
+};
+
+#endif //!H_GROUP
@@ -0,0 +1,236 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  High dynamic range image output
+*  PFM: a text header, then rows of RGB floats from the
+*  bottom of the image up; a negative scale marks them as
+*  little endian.
+*  EXR: the magic number and version, a header of named
+*  attributes, a table of scanline offsets, then one block
+*  per scanline from the top down, holding the B, G and R
+*  channels (names in sorted order) as half floats. All
+*  values are little endian.
+-------------------------------------------------------------*/
+
+#include "HdrImage.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+* Converts to IEEE half precision, rounding to nearest even. Values too
+* large become infinity and values too small become zero.
+*/
+unsigned short floatToHalf(float value)
+{
+	unsigned int f;
+	memcpy(&f, &value, sizeof(f));
+	unsigned int sign = (f >> 16) & 0x8000;
+	int exponent = (int)((f >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = f & 0x7fffff;
+
+	if (((f >> 23) & 0xff) == 0xff)								//Inf or NaN
+	{
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	}
+	if (exponent >= 31) return sign | 0x7c00;						//Overflow
+	if (exponent <= 0)												//Denormal or zero
+	{
+		if (exponent < -10) return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) half++;
+		return sign | half;
+	}
+
+	unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+	unsigned int rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;	//May carry into the exponent, which is correct
+	return half;
+}
+
+glm::vec3 toneMap(glm::vec3 colour, float exposure, float gamma)
+{
+	colour *= exposure;
+	float luminance = glm::dot(colour, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	if (luminance > 0) colour *= 1 / (1 + luminance);		//(L / (1 + L)) / L
+	colour = glm::clamp(colour, 0.0f, 1.0f);
+	return glm::pow(colour, glm::vec3(1 / gamma));
+}
+
+static void putInt(std::vector<unsigned char>& out, unsigned int v)
+{
+	for (int i = 0; i < 4; i++) out.push_back((v >> (8 * i)) & 0xff);
+}
+
+static void putFloat(std::vector<unsigned char>& out, float v)
+{
+	unsigned int bits;
+	memcpy(&bits, &v, sizeof(bits));
+	putInt(out, bits);
+}
+
+static void putString(std::vector<unsigned char>& out, const char *s)
+{
+	out.insert(out.end(), s, s + strlen(s) + 1);
+}
+
+static void putAttribute(std::vector<unsigned char>& out, const char *name, const char *type,
+	const std::vector<unsigned char>& value)
+{
+	putString(out, name);
+	putString(out, type);
+	putInt(out, value.size());
+	out.insert(out.end(), value.begin(), value.end());
+}
+
+bool writePfm(const char *path, int width, int height, RowSource source)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == nullptr) return false;
+	fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+
+	std::vector<glm::vec3> row(width);
+	std::vector<unsigned char> bytes;
+	bytes.reserve(width * 12);
+	for (int y = 0; y < height; y++)
+	{
+		source(y, row.data());
+		bytes.clear();
+		for (int x = 0; x < width; x++)
+		{
+			putFloat(bytes, row[x].r);
+			putFloat(bytes, row[x].g);
+			putFloat(bytes, row[x].b);
+		}
+		fwrite(bytes.data(), 1, bytes.size(), file);
+	}
+	return fclose(file) == 0;
+}
+
+bool readPfm(const char *path, int width, int height, RowSink sink)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr) return false;
+	char magic[3] = {};
+	int fileWidth, fileHeight;
+	float scale;
+	if (fscanf(file, "%2s %d %d %f", magic, &fileWidth, &fileHeight, &scale) != 4 || strcmp(magic, "PF") != 0
+		|| fileWidth != width || fileHeight != height || fgetc(file) == EOF)	//One whitespace byte ends the header
+	{
+		fclose(file);
+		return false;
+	}
+
+	bool swap = scale > 0;			//Positive scale means big endian
+	std::vector<unsigned char> bytes(width * 12);
+	std::vector<glm::vec3> row(width);
+	for (int y = 0; y < height; y++)
+	{
+		if (fread(bytes.data(), 1, bytes.size(), file) != bytes.size())
+		{
+			fclose(file);
+			return false;
+		}
+		for (int i = 0; i < width * 3; i++)
+		{
+			unsigned char *b = &bytes[4 * i];
+			unsigned int bits = swap ? ((unsigned int)b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3])
+				: ((unsigned int)b[3] << 24 | b[2] << 16 | b[1] << 8 | b[0]);
+			memcpy(&row[i / 3][i % 3], &bits, sizeof(bits));
+		}
+		sink(y, row.data());
+	}
+	fclose(file);
+	return true;
+}
+
+bool writeExr(const char *path, int width, int height, RowSource source)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == nullptr) return false;
+
+	std::vector<unsigned char> header;
+	putInt(header, 20000630);		//Magic number
+	putInt(header, 2);				//Version 2, single part scanline image
+
+	std::vector<unsigned char> value;
+	const char *channels[3] = { "B", "G", "R" };
+	for (int c = 0; c < 3; c++)
+	{
+		putString(value, channels[c]);
+		putInt(value, 1);			//HALF
+		putInt(value, 0);			//pLinear and reserved bytes
+		putInt(value, 1);			//x sampling
+		putInt(value, 1);			//y sampling
+	}
+	value.push_back(0);
+	putAttribute(header, "channels", "chlist", value);
+
+	putAttribute(header, "compression", "compression", { 0 });		//NO_COMPRESSION
+	value.clear();
+	putInt(value, 0);
+	putInt(value, 0);
+	putInt(value, width - 1);
+	putInt(value, height - 1);
+	putAttribute(header, "dataWindow", "box2i", value);
+	putAttribute(header, "displayWindow", "box2i", value);
+	putAttribute(header, "lineOrder", "lineOrder", { 0 });			//INCREASING_Y
+	value.clear();
+	putFloat(value, 1);
+	putAttribute(header, "pixelAspectRatio", "float", value);
+	value.clear();
+	putFloat(value, 0);
+	putFloat(value, 0);
+	putAttribute(header, "screenWindowCenter", "v2f", value);
+	value.clear();
+	putFloat(value, 1);
+	putAttribute(header, "screenWindowWidth", "float", value);
+	header.push_back(0);
+
+	// Uncompressed blocks all have the same size, so the offsets are known up front
+	unsigned long long blockSize = 8 + (unsigned long long)width * 3 * 2;
+	unsigned long long offset = header.size() + (unsigned long long)height * 8;
+	for (int y = 0; y < height; y++)
+	{
+		putInt(header, (unsigned int)(offset & 0xffffffff));
+		putInt(header, (unsigned int)(offset >> 32));
+		offset += blockSize;
+	}
+	fwrite(header.data(), 1, header.size(), file);
+
+	std::vector<glm::vec3> row(width);
+	std::vector<unsigned char> block;
+	block.reserve(blockSize);
+	for (int line = 0; line < height; line++)
+	{
+		source(height - 1 - line, row.data());		//EXR scanlines run from the top down
+		block.clear();
+		putInt(block, line);
+		putInt(block, width * 3 * 2);
+		for (int c = 2; c >= 0; c--)					//B, G, R
+		{
+			for (int x = 0; x < width; x++)
+			{
+				unsigned short h = floatToHalf(row[x][c]);
+				block.push_back(h & 0xff);
+				block.push_back(h >> 8);
+			}
+		}
+		fwrite(block.data(), 1, block.size(), file);
+	}
+	return fclose(file) == 0;
+}
+
+bool writeHdr(const char *path, int width, int height, RowSource source)
+{
+	std::string name(path);
+	size_t dot = name.rfind('.');
+	std::string extension = dot == std::string::npos ? "" : name.substr(dot);
+	if (extension == ".exr" || extension == ".EXR") return writeExr(path, width, height, source);
+	return writePfm(path, width, height, source);
+}
@@ -0,0 +1,38 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  High dynamic range image output
+*  Writes unclamped float colours as PFM (32-bit float) or
+*  OpenEXR (16-bit half float, uncompressed scanlines) with
+*  no external libraries. Images are streamed a row at a
+*  time, so the whole image is never copied in memory.
+-------------------------------------------------------------*/
+
+#ifndef H_HDRIMAGE
+#define H_HDRIMAGE
+#include <functional>
+#include <glm/glm.hpp>
+
+// Fills row y (0 = bottom) of the image, width colours long.
+typedef std::function<void(int y, glm::vec3* row)> RowSource;
+
+// Receives row y (0 = bottom) of an image being read.
+typedef std::function<void(int y, const glm::vec3* row)> RowSink;
+
+bool writePfm(const char *path, int width, int height, RowSource source);
+bool writeExr(const char *path, int width, int height, RowSource source);
+
+// Reads a colour PFM, which must be width x height. Returns false if it
+// cannot be opened, is not a colour PFM or has another size.
+bool readPfm(const char *path, int width, int height, RowSink sink);
+
+// Picks the format from the file extension: ".exr" or ".pfm".
+bool writeHdr(const char *path, int width, int height, RowSource source);
+
+unsigned short floatToHalf(float value);
+
+// Maps an unbounded colour into [0, 1]: scales by exposure, compresses
+// luminance with Reinhard's L / (1 + L), then applies display gamma.
+glm::vec3 toneMap(glm::vec3 colour, float exposure, float gamma);
+
+#endif //!H_HDRIMAGE
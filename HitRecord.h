@@ -0,0 +1,31 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Hit record
+*  Everything shading needs to know about a ray's closest
+*  hit. It is filled once per hit by the object that was hit,
+*  so the normal, texture coordinates and tangents are not
+*  worked out again by each part of the shading code.
+-------------------------------------------------------------*/
+
+#ifndef H_HITRECORD
+#define H_HITRECORD
+#include <glm/glm.hpp>
+
+class SceneObject;
+
+struct HitRecord
+{
+	float t = -1;								//Distance along the ray
+	float time = 0;								//Shutter time of the ray
+	glm::vec3 position = glm::vec3(0);			//World space hit point
+	glm::vec3 normal = glm::vec3(0, 1, 0);		//Geometric unit normal
+	glm::vec3 shadingNormal = glm::vec3(0, 1, 0);	//Normal after normal mapping
+	glm::vec2 uv = glm::vec2(0);				//Surface texture coordinates
+	glm::vec3 dpdu = glm::vec3(1, 0, 0);		//Unit surface tangent along u
+	glm::vec3 dpdv = glm::vec3(0, 0, 1);		//Unit surface tangent along v
+	SceneObject* object = nullptr;				//Object that gives the material
+	int index = -1;								//Index of that object in the scene
+};
+
+#endif //!H_HITRECORD
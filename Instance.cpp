@@ -0,0 +1,90 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The instance class
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#include "Instance.h"
+
+Instance::Instance(SceneObject* g, glm::mat4 transform) : geometry(g)
+{
+	this->type_ = InstanceObject;
+	setTransform(transform);
+}
+
+void Instance::setTransform(glm::mat4 transform)
+{
+	toWorld = transform;
+	toLocal = glm::inverse(transform);
+	normalMatrix = glm::transpose(glm::mat3(toLocal));
+}
+
+/**
+* Intersects the geometry with the ray in object space. The geometry expects
+* a unit direction, so the local distance is rescaled to world units.
+*/
+float Instance::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+	glm::vec3 localP0 = glm::vec3(toLocal * glm::vec4(p0, 1));
+	glm::vec3 localDir = glm::mat3(toLocal) * dir;
+	float scale = glm::length(localDir);
+
+	float t = geometry->intersect(localP0, localDir / scale);
+	if (t < 0) return -1;
+	return t / scale;
+}
+
+bool Instance::interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar)
+{
+	glm::vec3 localP0 = glm::vec3(toLocal * glm::vec4(p0, 1));
+	glm::vec3 localDir = glm::mat3(toLocal) * dir;
+	float scale = glm::length(localDir);
+
+	if (!geometry->interval(localP0, localDir / scale, tNear, tFar)) return false;
+	tNear /= scale;
+	tFar /= scale;
+	return true;
+}
+
+glm::vec3 Instance::normal(glm::vec3 p)
+{
+	glm::vec3 localP = glm::vec3(toLocal * glm::vec4(p, 1));
+	return glm::normalize(normalMatrix * geometry->normal(localP));
+}
+
+/**
+* Lets the geometry fill the record in its own space, then carries the
+* results back to world space.
+*/
+void Instance::fillHit(HitRecord& hit)
+{
+	glm::vec3 worldPos = hit.position;
+	hit.position = glm::vec3(toLocal * glm::vec4(worldPos, 1));
+	geometry->fillHit(hit);
+
+	glm::mat3 linear(toWorld);
+	hit.position = worldPos;
+	hit.normal = glm::normalize(normalMatrix * hit.normal);
+	hit.shadingNormal = glm::normalize(normalMatrix * hit.shadingNormal);
+	hit.dpdu = glm::normalize(linear * hit.dpdu);
+	hit.dpdv = glm::normalize(linear * hit.dpdv);
+}
+
+/**
+* World space box around the eight transformed corners of the geometry's box.
+*/
+AABB Instance::getBounds()
+{
+	AABB local = geometry->getBounds();
+	AABB box;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? local.maxPt.x : local.minPt.x,
+						 (i & 2) ? local.maxPt.y : local.minPt.y,
+						 (i & 4) ? local.maxPt.z : local.minPt.z);
+		box.expand(glm::vec3(toWorld * glm::vec4(corner, 1)));
+	}
+	return box;
+}
@@ -0,0 +1,47 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The instance class
+*  Places a shared piece of geometry in the scene with an
+*  affine transform. Rays are moved into the geometry's own
+*  space rather than the geometry being copied, so repeated
+*  objects cost one Instance each on top of a single copy of
+*  the geometry. Material settings belong to the Instance.
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#ifndef H_INSTANCE
+#define H_INSTANCE
+#include <glm/glm.hpp>
+#include "SceneObject.h"
+
+class Instance : public SceneObject
+{
+
+private:
+	SceneObject* geometry = nullptr;
+	glm::mat4 toWorld = glm::mat4(1);		//object space -> world space
+	glm::mat4 toLocal = glm::mat4(1);		//world space -> object space
+	glm::mat3 normalMatrix = glm::mat3(1);	//transforms object space normals to world space
+
+public:
+	Instance() { this->type_ = InstanceObject; }
+
+	Instance(SceneObject* g, glm::mat4 transform);
+
+	float intersect(glm::vec3 p0, glm::vec3 dir);
+
+	bool interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar);
+
+	glm::vec3 normal(glm::vec3 p);
+
+	void fillHit(HitRecord& hit);
+
+	AABB getBounds();
+
+	void setTransform(glm::mat4 transform);
+
+};
+
+#endif //!H_INSTANCE
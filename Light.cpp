@@ -0,0 +1,66 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The light class
+*  This is a generic type for storing light sources in the
+*  scene. Being an abstract class, this class cannot be
+*  instantiated.
+-------------------------------------------------------------*/
+
+#include "Light.h"
+
+glm::vec3 Light::getColor()
+{
+	return color_;
+}
+
+float Light::getIntensity()
+{
+	return intensity_;
+}
+
+int Light::getNumSamples()
+{
+	return samples_;
+}
+
+/**
+* Colour of the light scaled by its intensity.
+*/
+glm::vec3 Light::getRadiance()
+{
+	return color_ * intensity_;
+}
+
+/**
+* Scalar estimate of how much light this source emits.
+* Used to importance sample the scene's light list.
+*/
+float Light::getPower()
+{
+	return intensity_ * (color_.r + color_.g + color_.b) / 3.0f;
+}
+
+LightType Light::getType()
+{
+	return type_;
+}
+
+void Light::setColor(glm::vec3 col)
+{
+	color_ = col;
+}
+
+void Light::setIntensity(float intensity)
+{
+	intensity_ = intensity;
+}
+
+/**
+* Sets the number of shadow rays fired at this light per shading point.
+* Area lights round this down to a square grid of strata.
+*/
+void Light::setSamples(int samples)
+{
+	samples_ = samples < 1 ? 1 : samples;
+}
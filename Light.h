@@ -0,0 +1,57 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The light class
+*  This is a generic type for storing light sources in the
+*  scene. Being an abstract class, this class cannot be
+*  instantiated. PointLight etc. must be defined as subclasses
+*  of Light and provide an implementation of samplePoint(),
+*  which maps (u, v) in [0,1)^2 to a point on the light as
+*  seen from the shading point.
+-------------------------------------------------------------*/
+
+#ifndef H_LIGHT
+#define H_LIGHT
+#include <glm/glm.hpp>
+
+typedef enum LightType {
+	PointLightType,
+	RectLightType,
+	SphereLightType
+} LightType;
+
+/**
+ * The light arriving at a shading point from one shadow ray.
+ * The intensity already includes shadowing and the sampling weight,
+ * so lighting() only has to add the contributions up.
+ */
+struct LightSample
+{
+	glm::vec3 position = glm::vec3(0);		//Point on the light the shadow ray was aimed at
+	glm::vec3 intensity = glm::vec3(0);		//Weighted light reaching the shading point
+};
+
+class Light
+{
+protected:
+	glm::vec3 color_ = glm::vec3(1);	//light colour
+	float intensity_ = 1.0;				//scale applied to the colour
+	int samples_ = 1;					//shadow rays per shading point
+	LightType type_ = PointLightType;
+public:
+	Light() {}
+	virtual glm::vec3 samplePoint(glm::vec3 from, float u, float v) = 0;
+	virtual ~Light() {}
+
+	glm::vec3 getColor();
+	float getIntensity();
+	int getNumSamples();
+	glm::vec3 getRadiance();
+	float getPower();
+	LightType getType();
+	void setColor(glm::vec3 col);
+	void setIntensity(float intensity);
+	void setSamples(int samples);
+};
+
+#endif //!H_LIGHT
@@ -0,0 +1,50 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The light list class
+*  Stores the lights in the scene along with a cumulative
+*  power table, so that lights can be picked with probability
+*  proportional to the power they emit.
+-------------------------------------------------------------*/
+
+#include "LightList.h"
+#include <algorithm>
+
+void LightList::add(Light* light)
+{
+	totalPower_ += light->getPower();
+	lights_.push_back(light);
+	cdf_.push_back(totalPower_);
+}
+
+Light* LightList::get(int i)
+{
+	return lights_[i];
+}
+
+int LightList::size()
+{
+	return lights_.size();
+}
+
+/**
+* Picks a light with probability proportional to its power.
+* u is a number in [0,1). The probability of picking the returned
+* light is written to pdf. The search is O(log n) in the number of lights.
+*/
+int LightList::sample(float u, float& pdf)
+{
+	if (lights_.empty() || totalPower_ <= 0)
+	{
+		pdf = 0;
+		return -1;
+	}
+
+	float target = u * totalPower_;
+	int i = std::upper_bound(cdf_.begin(), cdf_.end(), target) - cdf_.begin();
+	if (i >= (int)lights_.size()) i = lights_.size() - 1;
+
+	float prev = (i == 0) ? 0 : cdf_[i - 1];
+	pdf = (cdf_[i] - prev) / totalPower_;
+	return i;
+}
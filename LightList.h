@@ -0,0 +1,35 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The light list class
+*  Stores the lights in the scene along with a cumulative
+*  power table, so that lights can be picked with probability
+*  proportional to the power they emit.
+-------------------------------------------------------------*/
+
+#ifndef H_LIGHTLIST
+#define H_LIGHTLIST
+#include <vector>
+#include "Light.h"
+
+class LightList
+{
+private:
+	std::vector<Light*> lights_;
+	std::vector<float> cdf_;		//Running sum of light powers
+	float totalPower_ = 0;
+
+public:
+	LightList() {}
+
+	void add(Light* light);
+
+	Light* get(int i);
+
+	int size();
+
+	int sample(float u, float& pdf);
+
+};
+
+#endif //!H_LIGHTLIST
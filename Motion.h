@@ -0,0 +1,91 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Rigid motion over the shutter interval
+*  While the shutter is open an object turns by angle about
+*  an axis through pivot and moves by shift, both growing
+*  linearly with the shutter time, from 0 when it opens to 1
+*  when it closes. The motion is rigid, so distances along a
+*  ray are the same before and after it is applied.
+-------------------------------------------------------------*/
+
+#ifndef H_MOTION
+#define H_MOTION
+#include <glm/glm.hpp>
+#include <math.h>
+#include "AABB.h"
+
+struct Motion
+{
+	glm::vec3 shift = glm::vec3(0);			//Distance moved while the shutter is open
+	glm::vec3 pivot = glm::vec3(0);			//A point on the axis turned about
+	glm::vec3 axis = glm::vec3(0, 1, 0);	//Unit axis
+	float angle = 0;						//Radians turned while the shutter is open
+
+	bool isMoving() const
+	{
+		return angle != 0 || shift.x != 0 || shift.y != 0 || shift.z != 0;
+	}
+
+	// Rodrigues' rotation of v by a radians about axis
+	glm::vec3 rotate(glm::vec3 v, float a) const
+	{
+		float c = cos(a);
+		float s = sin(a);
+		return v * c + glm::cross(axis, v) * s + axis * (glm::dot(axis, v) * (1 - c));
+	}
+
+	// Where point p at shutter time 'time' was when the shutter opened
+	glm::vec3 pointToOpen(glm::vec3 p, float time) const
+	{
+		return pivot + rotate(p - shift * time - pivot, -angle * time);
+	}
+
+	glm::vec3 vectorToOpen(glm::vec3 v, float time) const
+	{
+		return rotate(v, -angle * time);
+	}
+
+	glm::vec3 vectorFromOpen(glm::vec3 v, float time) const
+	{
+		return rotate(v, angle * time);
+	}
+
+	/**
+	* Box around everywhere the contents of box go while the shutter is open.
+	* A turn keeps every point at the same height along the axis and distance
+	* from it, so the swept shape fits in a cylinder about the axis; the
+	* shift then stretches that along the line the object moves.
+	*/
+	AABB sweep(const AABB& box) const
+	{
+		AABB swept = box;
+		if (angle != 0)
+		{
+			float lo = INFINITY, hi = -INFINITY, radius = 0;
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec3 corner((i & 1) ? box.maxPt.x : box.minPt.x,
+								 (i & 2) ? box.maxPt.y : box.minPt.y,
+								 (i & 4) ? box.maxPt.z : box.minPt.z);
+				glm::vec3 d = corner - pivot;
+				float along = glm::dot(d, axis);
+				lo = fmin(lo, along);
+				hi = fmax(hi, along);
+				radius = fmax(radius, glm::length(d - along * axis));
+			}
+			swept = AABB();
+			for (int i = 0; i < 3; i++)
+			{
+				float reach = radius * sqrt(fmax(0.0f, 1 - axis[i] * axis[i]));
+				swept.minPt[i] = pivot[i] + fmin(lo * axis[i], hi * axis[i]) - reach;
+				swept.maxPt[i] = pivot[i] + fmax(lo * axis[i], hi * axis[i]) + reach;
+			}
+		}
+		AABB shifted(swept.minPt + shift, swept.maxPt + shift);
+		swept.expand(shifted);
+		return swept;
+	}
+};
+
+#endif //!H_MOTION
@@ -1,22 +1,27 @@
 #include "Noise.h"
+#include "Random.h"
+#include <math.h>
 
 using namespace std;
 
 // Using this is a reference
 // https://lodev.org/cgtutor/randomnoise.html
 
-void generateNoise(float **noise, int noiseWidth, int noiseHeight)
+// Each value is a hash of its position and the seed rather than a call to
+// rand(), so the pattern is the same on every platform and the table can be
+// filled in any order.
+void generateNoise(float *noise, int noiseWidth, int noiseHeight, unsigned int seed)
 {
 	for (int y = 0; y < noiseHeight; y++)
 	{
 		for (int x = 0; x <  noiseWidth; x++)
 		{
-			noise[y][x] = (rand() % 32768) / 32768.0;
+			noise[y * noiseWidth + x] = (pcgHash(seed ^ pcgHash(y * noiseWidth + x)) % 32768) / 32768.0;
 		}
 	}
 }
 
-float smoothNoise(float **noise, int noiseWidth, int noiseHeight, float x, float y)
+float smoothNoise(const float *noise, int noiseWidth, int noiseHeight, float x, float y)
 {
     float fractX = x - int(x);
     float fractY = y - int(y);
@@ -27,16 +32,19 @@ float smoothNoise(float **noise, int noiseWidth, int noiseHeight, float x, float
     int x2 = (x1 + noiseWidth - 1) % noiseWidth;
     int y2 = (y1 + noiseHeight - 1) % noiseHeight;
 
+    const float *row1 = noise + y1 * noiseWidth;
+    const float *row2 = noise + y2 * noiseWidth;
+
     float value = 0.0;
-    value += fractX * fractY * noise[y1][x1];
-    value += (1 - fractX) * fractY * noise[y1][x2];
-    value += fractX * (1 - fractY) * noise[y2][x1];
-    value += (1 - fractX) * (1 - fractY) * noise[y2][x2];
+    value += fractX * fractY * row1[x1];
+    value += (1 - fractX) * fractY * row1[x2];
+    value += fractX * (1 - fractY) * row2[x1];
+    value += (1 - fractX) * (1 - fractY) * row2[x2];
 
     return value;
 }
 
-float turbulence(float **noise, int noiseWidth, int noiseHeight, float x, float y, float size)
+float turbulence(const float *noise, int noiseWidth, int noiseHeight, float x, float y, float size)
 {
     float value = 0.0;
     float initialSize = size;
@@ -48,4 +56,192 @@ float turbulence(float **noise, int noiseWidth, int noiseHeight, float x, float
     }
 
     return (128.0 * value / initialSize);
-}
\ No newline at end of file
+}
+
+// Same result as calling turbulence() for x = 0 .. noiseWidth - 1 on row y, written to out.
+// The rows sampled and fractY only depend on y, so they are worked out once per octave,
+// leaving an inner loop over x with no branches that the compiler can vectorise.
+void turbulenceRow(const float *noise, int noiseWidth, int noiseHeight, int y, float size, float *out)
+{
+    float initialSize = size;
+
+    for (int x = 0; x < noiseWidth; x++)
+    {
+        out[x] = 0.0;
+    }
+
+    while (size >= 1)
+    {
+        float fy = y / size;
+        float fractY = fy - int(fy);
+        int y1 = (int(fy) + noiseHeight) % noiseHeight;
+        int y2 = (y1 + noiseHeight - 1) % noiseHeight;
+        const float *row1 = noise + y1 * noiseWidth;
+        const float *row2 = noise + y2 * noiseWidth;
+        float invSize = 1.0f / size;   // exact, as size is a power of two
+
+        for (int x = 0; x < noiseWidth; x++)
+        {
+            float fx = x * invSize;
+            int ix = int(fx);
+            float fractX = fx - ix;
+            int x1 = ix % noiseWidth;
+            int x2 = (x1 + noiseWidth - 1) % noiseWidth;
+
+            float value = fractX * fractY * row1[x1]
+                + (1 - fractX) * fractY * row1[x2]
+                + fractX * (1 - fractY) * row2[x1]
+                + (1 - fractX) * (1 - fractY) * row2[x2];
+            out[x] += value * size;
+        }
+        size /= 2.0;
+    }
+
+    for (int x = 0; x < noiseWidth; x++)
+    {
+        out[x] = 128.0f * out[x] / initialSize;
+    }
+}
+
+// Dot product of the gradient at lattice point (ix, iy) with the offset (dx, dy).
+// Gradients are picked from eight directions by hashing the lattice point.
+static float gradientDot(int ix, int iy, float dx, float dy, unsigned int seed)
+{
+    static const float gradients[8][2] = {
+        { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+        { 0.7071f, 0.7071f }, { -0.7071f, 0.7071f }, { 0.7071f, -0.7071f }, { -0.7071f, -0.7071f }
+    };
+    unsigned int h = pcgHash(seed ^ pcgHash(ix ^ pcgHash(iy)));
+    const float *g = gradients[h & 7];
+    return g[0] * dx + g[1] * dy;
+}
+
+// 2D gradient (Perlin) noise in [0,1), wrapping every periodX by periodY lattice cells
+float gradientNoise(float x, float y, int periodX, int periodY, unsigned int seed)
+{
+    float fx = floor(x);
+    float fy = floor(y);
+    float dx = x - fx;
+    float dy = y - fy;
+    int x0 = ((int)fx % periodX + periodX) % periodX;
+    int y0 = ((int)fy % periodY + periodY) % periodY;
+    int x1 = (x0 + 1) % periodX;
+    int y1 = (y0 + 1) % periodY;
+
+    float u = dx * dx * dx * (dx * (dx * 6 - 15) + 10);   // quintic fade
+    float v = dy * dy * dy * (dy * (dy * 6 - 15) + 10);
+
+    float n00 = gradientDot(x0, y0, dx, dy, seed);
+    float n10 = gradientDot(x1, y0, dx - 1, dy, seed);
+    float n01 = gradientDot(x0, y1, dx, dy - 1, seed);
+    float n11 = gradientDot(x1, y1, dx - 1, dy - 1, seed);
+
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    float value = 0.5f + 0.7071f * (nx0 + v * (nx1 - nx0));
+    return value < 0 ? 0 : (value > 0.999999f ? 0.999999f : value);
+}
+
+// turbulence() with gradient noise in place of the table; same scale and range
+float gradientTurbulence(float x, float y, int periodX, int periodY, float size, unsigned int seed)
+{
+    float value = 0.0;
+    float initialSize = size;
+
+    while (size >= 1)
+    {
+        int octavePeriodX = (int)(periodX / size);
+        int octavePeriodY = (int)(periodY / size);
+        value += gradientNoise(x / size, y / size,
+            octavePeriodX > 0 ? octavePeriodX : 1, octavePeriodY > 0 ? octavePeriodY : 1, seed) * size;
+        size /= 2.0;
+    }
+
+    return (128.0 * value / initialSize);
+}
+
+// Gradient for 3D lattice point hash h, dotted with (x, y, z).
+// Picks one of the 12 cube edge directions (Perlin 2002) with selects
+// rather than a table lookup, so it vectorises without gathers.
+static float gradientDot3(unsigned int h, float x, float y, float z)
+{
+    h &= 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+static unsigned int latticeHash(int x, int y, int z, unsigned int seed)
+{
+    return pcgHash(seed ^ pcgHash(x ^ pcgHash(y ^ pcgHash(z))));
+}
+
+float noise3(float x, float y, float z, unsigned int seed)
+{
+    float fx = floor(x);
+    float fy = floor(y);
+    float fz = floor(z);
+    int ix = (int)fx;
+    int iy = (int)fy;
+    int iz = (int)fz;
+    float dx = x - fx;
+    float dy = y - fy;
+    float dz = z - fz;
+
+    float u = dx * dx * dx * (dx * (dx * 6 - 15) + 10);   // quintic fade
+    float v = dy * dy * dy * (dy * (dy * 6 - 15) + 10);
+    float w = dz * dz * dz * (dz * (dz * 6 - 15) + 10);
+
+    float n000 = gradientDot3(latticeHash(ix, iy, iz, seed), dx, dy, dz);
+    float n100 = gradientDot3(latticeHash(ix + 1, iy, iz, seed), dx - 1, dy, dz);
+    float n010 = gradientDot3(latticeHash(ix, iy + 1, iz, seed), dx, dy - 1, dz);
+    float n110 = gradientDot3(latticeHash(ix + 1, iy + 1, iz, seed), dx - 1, dy - 1, dz);
+    float n001 = gradientDot3(latticeHash(ix, iy, iz + 1, seed), dx, dy, dz - 1);
+    float n101 = gradientDot3(latticeHash(ix + 1, iy, iz + 1, seed), dx - 1, dy, dz - 1);
+    float n011 = gradientDot3(latticeHash(ix, iy + 1, iz + 1, seed), dx, dy - 1, dz - 1);
+    float n111 = gradientDot3(latticeHash(ix + 1, iy + 1, iz + 1, seed), dx - 1, dy - 1, dz - 1);
+
+    float nx00 = n000 + u * (n100 - n000);
+    float nx10 = n010 + u * (n110 - n010);
+    float nx01 = n001 + u * (n101 - n001);
+    float nx11 = n011 + u * (n111 - n011);
+    float nxy0 = nx00 + v * (nx10 - nx00);
+    float nxy1 = nx01 + v * (nx11 - nx01);
+    return nxy0 + w * (nxy1 - nxy0);
+}
+
+// Fractal sum of noise3() with frequency doubling and amplitude halving each octave
+float fbm3(float x, float y, float z, float octaves, unsigned int seed)
+{
+    float value = 0.0;
+    float amplitude = 1.0;
+    float frequency = 1.0;
+
+    for (int i = 0; i < octaves; i++)
+    {
+        float fade = (octaves - i < 1) ? octaves - i : 1;
+        value += fade * amplitude * noise3(x * frequency, y * frequency, z * frequency, seed + i);
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+
+    return value;
+}
+
+// As fbm3(), summing the absolute value of each octave
+float turbulence3(float x, float y, float z, float octaves, unsigned int seed)
+{
+    float value = 0.0;
+    float amplitude = 1.0;
+    float frequency = 1.0;
+
+    for (int i = 0; i < octaves; i++)
+    {
+        float fade = (octaves - i < 1) ? octaves - i : 1;
+        value += fade * amplitude * fabs(noise3(x * frequency, y * frequency, z * frequency, seed + i));
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+
+    return value;
+}
@@ -2,8 +2,20 @@
 #define H_NOISE
 #include <stdlib.h>
 
-void generateNoise(float **noise, int noiseWidth, int noiseHeight);
-float smoothNoise(float **noise, int noiseWidth, int noiseHeight, float x, float y);
-float turbulence(float **noise, int noiseWidth, int noiseHeight, float x, float y, float size);
+// Noise tables are stored row by row in one contiguous block: noise[y * noiseWidth + x]
+void generateNoise(float *noise, int noiseWidth, int noiseHeight, unsigned int seed);
+float smoothNoise(const float *noise, int noiseWidth, int noiseHeight, float x, float y);
+float turbulence(const float *noise, int noiseWidth, int noiseHeight, float x, float y, float size);
+void turbulenceRow(const float *noise, int noiseWidth, int noiseHeight, int y, float size, float *out);
 
-#endif
\ No newline at end of file
+// Procedural versions that need no table, tiling every periodX by periodY units
+float gradientNoise(float x, float y, int periodX, int periodY, unsigned int seed);
+float gradientTurbulence(float x, float y, int periodX, int periodY, float size, unsigned int seed);
+
+// 3D gradient noise in [-1,1] and sums of it over octaves. octaves may be fractional,
+// in which case the last octave is faded in by the fractional part.
+float noise3(float x, float y, float z, unsigned int seed);
+float fbm3(float x, float y, float z, float octaves, unsigned int seed);
+float turbulence3(float x, float y, float z, float octaves, unsigned int seed);
+
+#endif
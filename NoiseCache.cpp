@@ -0,0 +1,184 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  On-disk cache for baked noise tables
+*  File layout: a NoiseCacheHeader followed by width * height
+*  floats, row by row, in host byte order. The header holds a
+*  checksum of the floats, so a file with a damaged table is
+*  rejected even when its size and key are right.
+-------------------------------------------------------------*/
+
+#include "NoiseCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct NoiseCacheHeader
+{
+	char magic[4];				//"RTNC"
+	unsigned int version;		//NOISE_CACHE_VERSION
+	unsigned long long key;		//noiseCacheKey() of the table
+	int width;
+	int height;
+	unsigned long long checksum;	//FNV-1a of the table's bytes
+};
+
+// FNV-1a over the bytes of value
+static void hashBytes(unsigned long long& hash, const void *value, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)value;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+static unsigned long long tableChecksum(const float *data, int width, int height)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	hashBytes(hash, data, (size_t)width * height * sizeof(float));
+	return hash;
+}
+
+/**
+* Hashes the cache version, table size, seed and generator parameters.
+*/
+unsigned long long noiseCacheKey(const float *params, int numParams, unsigned int seed, int width, int height)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned int version = NOISE_CACHE_VERSION;
+	hashBytes(hash, &version, sizeof(version));
+	hashBytes(hash, &width, sizeof(width));
+	hashBytes(hash, &height, sizeof(height));
+	hashBytes(hash, &seed, sizeof(seed));
+	hashBytes(hash, params, numParams * sizeof(float));
+	return hash;
+}
+
+std::string noiseCachePath(const char *name, unsigned long long key)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s_%016llx.noisecache", name, key);
+	return std::string(path);
+}
+
+/**
+* Maps the cache file at path and returns a pointer to its table, or nullptr
+* if the file is missing, truncated, damaged or was written for a different key.
+* The mapping stays open for the rest of the run.
+*/
+const float* loadNoiseCache(const char *path, unsigned long long key, int width, int height)
+{
+	size_t size = sizeof(NoiseCacheHeader) + (size_t)width * height * sizeof(float);
+	const char *bytes = nullptr;
+
+#ifdef _WIN32
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr) return nullptr;
+	char *buffer = (char *)malloc(size);
+	size_t read = fread(buffer, 1, size, file);
+	int extra = fgetc(file);
+	fclose(file);
+	if (read != size || extra != EOF)
+	{
+		free(buffer);
+		return nullptr;
+	}
+	bytes = buffer;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size != size)
+	{
+		close(fd);
+		return nullptr;
+	}
+	void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) return nullptr;
+	bytes = (const char *)mapped;
+#endif
+
+	NoiseCacheHeader header;
+	memcpy(&header, bytes, sizeof(header));
+	const float *table = (const float *)(bytes + sizeof(NoiseCacheHeader));
+	if (memcmp(header.magic, "RTNC", 4) != 0 || header.version != NOISE_CACHE_VERSION
+		|| header.key != key || header.width != width || header.height != height
+		|| header.checksum != tableChecksum(table, width, height))
+	{
+#ifdef _WIN32
+		free((void *)bytes);
+#else
+		munmap((void *)bytes, size);
+#endif
+		return nullptr;
+	}
+
+	return table;
+}
+
+/**
+* Writes a table to path. The file is written under a temporary name unique
+* to this call and renamed into place, so a run that is killed part way, or
+* several runs saving the same table at once, never leave a damaged cache
+* behind for the next one.
+*/
+bool saveNoiseCache(const char *path, unsigned long long key, int width, int height, const float *data)
+{
+	NoiseCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "RTNC", 4);
+	header.version = NOISE_CACHE_VERSION;
+	header.key = key;
+	header.width = width;
+	header.height = height;
+	header.checksum = tableChecksum(data, width, height);
+
+#ifdef _WIN32
+	char suffix[32];
+	static int saves = 0;
+	snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", _getpid(), saves++);
+	std::string tempPath = std::string(path) + suffix;
+	FILE *file = fopen(tempPath.c_str(), "wb");
+#else
+	std::string tempPath = std::string(path) + ".XXXXXX";
+	int fd = mkstemp(&tempPath[0]);
+	if (fd < 0) return false;
+	fchmod(fd, 0644);
+	FILE *file = fdopen(fd, "wb");
+	if (file == nullptr)
+	{
+		close(fd);
+		remove(tempPath.c_str());
+		return false;
+	}
+#endif
+	if (file == nullptr) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(data, sizeof(float), (size_t)width * height, file) == (size_t)width * height;
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	remove(path);
+#endif
+	if (rename(tempPath.c_str(), path) != 0)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  On-disk cache for baked noise tables
+*  A table is stored in a file named after a hash of every
+*  parameter that went into it, so a cache file can only be
+*  picked up by a run that would have baked the same table.
+*  Cached tables are memory-mapped rather than read in.
+-------------------------------------------------------------*/
+
+#ifndef H_NOISECACHE
+#define H_NOISECACHE
+#include <string>
+
+// Bump whenever the noise or marble code changes what a table contains.
+#define NOISE_CACHE_VERSION 2
+
+unsigned long long noiseCacheKey(const float *params, int numParams, unsigned int seed, int width, int height);
+std::string noiseCachePath(const char *name, unsigned long long key);
+const float* loadNoiseCache(const char *path, unsigned long long key, int width, int height);
+bool saveNoiseCache(const char *path, unsigned long long key, int width, int height, const float *data);
+
+#endif //!H_NOISECACHE
@@ -28,17 +28,42 @@ float Plane::intersect(glm::vec3 p0, glm::vec3 dir)
     else return -1;
 }
 
+/**
+* Works out the normal and tangent frame once, as they are the same
+* everywhere on the polygon.
+*/
+void Plane::setFrame()
+{
+	glm::vec3 v1 = c_-b_;
+	glm::vec3 v2 = a_-b_;
+	normal_ = glm::normalize(glm::cross(v1, v2));
+	lenU_ = glm::length(b_ - a_);
+	lenV_ = glm::length(c_ - b_);
+	tangent_ = (b_ - a_) / lenU_;
+	bitangent_ = glm::cross(normal_, tangent_);
+}
+
 /**
 * Returns the unit normal vector at a given point.
 * Assumption: The input point p lies on the plane.
 */
 glm::vec3 Plane::normal(glm::vec3 p)
 {
-	glm::vec3 v1 = c_-b_;
-	glm::vec3 v2 = a_-b_;
-	glm::vec3 n = glm::cross(v1, v2);
-	n = glm::normalize(n);
-    return n;
+    return normal_;
+}
+
+/**
+* Texture coordinates measured from vertex a along the first edge (u) and
+* across it (v), scaled by the edge lengths.
+*/
+void Plane::fillHit(HitRecord& hit)
+{
+	glm::vec3 rel = hit.position - a_;
+	hit.normal = normal_;
+	hit.shadingNormal = normal_;
+	hit.dpdu = tangent_;
+	hit.dpdv = bitangent_;
+	hit.uv = glm::vec2(glm::dot(rel, tangent_) / lenU_, glm::dot(rel, bitangent_) / lenV_);
 }
 
 /**
@@ -72,5 +97,15 @@ int  Plane::getNumVerts()
 	return nverts_;
 }
 
-
-
+/**
+* Axis-aligned box enclosing the polygon's vertices.
+*/
+AABB Plane::getBounds()
+{
+	AABB box;
+	box.expand(a_);
+	box.expand(b_);
+	box.expand(c_);
+	if (nverts_ == 4) box.expand(d_);
+	return box;
+}
@@ -20,15 +20,21 @@ private:
 	glm::vec3 c_ = glm::vec3(0);
 	glm::vec3 d_ = glm::vec3(0);
 	int nverts_ = 4;				//Number of vertices (3 or 4)
+	glm::vec3 normal_ = glm::vec3(0, 1, 0);		//Unit normal, fixed for the whole polygon
+	glm::vec3 tangent_ = glm::vec3(1, 0, 0);	//Unit tangent along a->b (u)
+	glm::vec3 bitangent_ = glm::vec3(0, 0, -1);	//Unit tangent across it (v)
+	float lenU_ = 1, lenV_ = 1;					//Edge lengths a->b and b->c
+
+	void setFrame();
 
 public:	
 	Plane() = default;
 	
 	Plane(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc, glm::vec3 pd) : 
-		a_(pa), b_(pb), c_(pc), d_(pd), nverts_(4) { this->type_ = PlaneObject; }
+		a_(pa), b_(pb), c_(pc), d_(pd), nverts_(4) { this->type_ = PlaneObject; setFrame(); }
 
 	Plane(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc) :
-		a_(pa), b_(pb), c_(pc),  nverts_(3) { this->type_ = PlaneObject; }
+		a_(pa), b_(pb), c_(pc),  nverts_(3) { this->type_ = PlaneObject; setFrame(); }
 
 
 	bool isInside(glm::vec3 pt);
@@ -39,6 +45,10 @@ public:
 	
 	glm::vec3 normal(glm::vec3 pt);
 
+	void fillHit(HitRecord& hit);
+
+	AABB getBounds();
+
 };
 
 #endif //!H_PLANE
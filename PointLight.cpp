@@ -0,0 +1,17 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The point light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#include "PointLight.h"
+
+/**
+* A point light has no extent, so every sample is the light's position.
+*/
+glm::vec3 PointLight::samplePoint(glm::vec3 from, float u, float v)
+{
+	return position;
+}
@@ -0,0 +1,32 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The point light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#ifndef H_POINTLIGHT
+#define H_POINTLIGHT
+#include <glm/glm.hpp>
+#include "Light.h"
+
+/**
+ * Defines a light that emits from a single point
+ */
+class PointLight : public Light
+{
+
+private:
+	glm::vec3 position = glm::vec3(0);
+
+public:
+	PointLight() { this->type_ = PointLightType; }
+
+	PointLight(glm::vec3 p) : position(p) { this->type_ = PointLightType; }
+
+	glm::vec3 samplePoint(glm::vec3 from, float u, float v);
+
+};
+
+#endif //!H_POINTLIGHT
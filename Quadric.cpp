@@ -0,0 +1,154 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The quadric class
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#include "Quadric.h"
+#include <math.h>
+
+// Outer product u v^T
+static glm::mat3 outer(glm::vec3 u, glm::vec3 v)
+{
+	return glm::mat3(u * v.x, u * v.y, u * v.z);
+}
+
+/**
+* Ellipsoid centred at 'center' with semi-axes 'radii' along x, y and z.
+*/
+Quadric* Quadric::ellipsoid(glm::vec3 center, glm::vec3 radii)
+{
+	glm::vec3 d = 1.0f / (radii * radii);
+	glm::mat3 a(glm::vec3(d.x, 0, 0), glm::vec3(0, d.y, 0), glm::vec3(0, 0, d.z));
+	glm::vec3 ac = a * center;
+	return new Quadric(a, -ac, glm::dot(center, ac) - 1, AABB(center - radii, center + radii));
+}
+
+/**
+* Capped cylinder of the given radius, from 'base' to base + height * axis.
+*/
+Quadric* Quadric::cylinder(glm::vec3 base, glm::vec3 axis, float radius, float height)
+{
+	axis = glm::normalize(axis);
+	glm::mat3 a = glm::mat3(1) - outer(axis, axis);
+	glm::vec3 ab = a * base;
+
+	glm::vec3 top = base + height * axis;
+	glm::vec3 extent = radius * glm::sqrt(glm::max(glm::vec3(1) - axis * axis, glm::vec3(0)));
+	AABB box(glm::min(base, top) - extent, glm::max(base, top) + extent);
+
+	Quadric* q = new Quadric(a, -ab, glm::dot(base, ab) - radius * radius, box);
+	q->setClip(base, axis, height, true);
+	return q;
+}
+
+/**
+* Capped cone with its tip at 'apex', opening along 'axis' with the given
+* half angle (radians), cut off at 'height' from the apex.
+*/
+Quadric* Quadric::cone(glm::vec3 apex, glm::vec3 axis, float halfAngle, float height)
+{
+	axis = glm::normalize(axis);
+	float cosSq = cos(halfAngle) * cos(halfAngle);
+	glm::mat3 a = glm::mat3(cosSq) - outer(axis, axis);
+	glm::vec3 aa = a * apex;
+
+	float radius = height * tan(halfAngle);
+	glm::vec3 base = apex + height * axis;
+	glm::vec3 extent = radius * glm::sqrt(glm::max(glm::vec3(1) - axis * axis, glm::vec3(0)));
+	AABB box(glm::min(apex, base - extent), glm::max(apex, base + extent));
+
+	Quadric* q = new Quadric(a, -aa, glm::dot(apex, aa), box);
+	q->setClip(apex, axis, height, true);
+	return q;
+}
+
+void Quadric::setClip(glm::vec3 o, glm::vec3 a, float h, bool caps)
+{
+	origin = o;
+	axis = glm::normalize(a);
+	height = h;
+	capped = caps;
+}
+
+/**
+* Quadric's intersection method. Solves the quadratic along the ray for the
+* curved surface, keeps the roots inside the clipping slab, and adds the
+* points where the ray crosses a cap plane inside the quadric.
+*/
+float Quadric::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+	glm::vec3 Ad = A * dir;
+	glm::vec3 Ap = A * p0;
+	float qa = glm::dot(dir, Ad);
+	float qb = glm::dot(dir, Ap) + glm::dot(b, dir);	//half of the linear coefficient
+	float qc = glm::dot(p0, Ap) + 2 * glm::dot(b, p0) + c;
+
+	float tmin = INFINITY;
+	auto consider = [&](float t)
+	{
+		if (t <= 0.001 || t >= tmin) return;
+		if (height > 0)
+		{
+			float h = glm::dot(p0 + t * dir - origin, axis);
+			if (h < 0 || h > height) return;
+		}
+		tmin = t;
+	};
+
+	if (fabs(qa) < 1.e-8)
+	{
+		if (fabs(qb) > 1.e-8) consider(-qc / (2 * qb));
+	}
+	else
+	{
+		float delta = qb * qb - qa * qc;
+		if (delta >= 0)
+		{
+			float root = sqrt(delta);
+			consider((-qb - root) / qa);
+			consider((-qb + root) / qa);
+		}
+	}
+
+	if (capped && height > 0)
+	{
+		float dDotAxis = glm::dot(dir, axis);
+		if (fabs(dDotAxis) > 1.e-8)
+		{
+			float h0 = glm::dot(p0 - origin, axis);
+			float capT[2] = { -h0 / dDotAxis, (height - h0) / dDotAxis };
+			for (int i = 0; i < 2; i++)
+			{
+				float t = capT[i];
+				if (t <= 0.001 || t >= tmin) continue;
+				glm::vec3 q = p0 + t * dir;
+				if (glm::dot(q, A * q) + 2 * glm::dot(b, q) + c <= 0) tmin = t;
+			}
+		}
+	}
+
+	return tmin < INFINITY ? tmin : -1.0;
+}
+
+/**
+* Returns the unit normal at p: the cap's normal on a cap, otherwise the
+* gradient of the quadric, which points out of the inside region.
+*/
+glm::vec3 Quadric::normal(glm::vec3 p)
+{
+	if (capped && height > 0)
+	{
+		float h = glm::dot(p - origin, axis);
+		if (fabs(h) < 1.e-3) return -axis;
+		if (fabs(h - height) < 1.e-3) return axis;
+	}
+	return glm::normalize(A * p + b);
+}
+
+AABB Quadric::getBounds()
+{
+	return bounds;
+}
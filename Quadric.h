@@ -0,0 +1,53 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The quadric class
+*  A general quadric surface  p.A.p + 2 b.p + c = 0  (negative
+*  inside), optionally clipped to a slab along an axis and
+*  closed off with flat caps. Cones, ellipsoids and cylinders
+*  along any axis are all made with the factory functions.
+*  This is a subclass of Object, and hence implements the
+*  methods intersect(), normal() and getBounds().
+-------------------------------------------------------------*/
+
+#ifndef H_QUADRIC
+#define H_QUADRIC
+#include <glm/glm.hpp>
+#include "SceneObject.h"
+
+class Quadric : public SceneObject
+{
+
+private:
+	glm::mat3 A = glm::mat3(1);			//Symmetric quadratic part
+	glm::vec3 b = glm::vec3(0);			//Linear part (halved)
+	float c = -1;						//Constant part
+	glm::vec3 origin = glm::vec3(0);	//Clipping: keep 0 <= axis.(p - origin) <= height
+	glm::vec3 axis = glm::vec3(0, 1, 0);
+	float height = 0;					//0 means not clipped
+	bool capped = false;				//Close the clipped ends with discs
+	AABB bounds;
+
+public:
+	Quadric() { this->type_ = QuadricObject; }
+
+	Quadric(glm::mat3 a, glm::vec3 lin, float k, AABB box) :
+		A(a), b(lin), c(k), bounds(box) { this->type_ = QuadricObject; }
+
+	static Quadric* ellipsoid(glm::vec3 center, glm::vec3 radii);
+
+	static Quadric* cylinder(glm::vec3 base, glm::vec3 axis, float radius, float height);
+
+	static Quadric* cone(glm::vec3 apex, glm::vec3 axis, float halfAngle, float height);
+
+	void setClip(glm::vec3 o, glm::vec3 a, float h, bool caps);
+
+	float intersect(glm::vec3 p0, glm::vec3 dir);
+
+	glm::vec3 normal(glm::vec3 p);
+
+	AABB getBounds();
+
+};
+
+#endif //!H_QUADRIC
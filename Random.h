@@ -0,0 +1,60 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Counter-based random numbers
+*  Every stream is keyed by the pixel, sample and frame it
+*  belongs to, and each number is a hash of that key and a
+*  counter. Results do not depend on which thread draws them
+*  or in what order pixels are traced, and there is no shared
+*  state for threads to fight over.
+-------------------------------------------------------------*/
+
+#ifndef H_RANDOM
+#define H_RANDOM
+
+/**
+ * PCG output permutation used as an integer hash.
+ * See Jarzynski and Olano, "Hash Functions for GPU Rendering" (JCGT 2020).
+ */
+inline unsigned int pcgHash(unsigned int v)
+{
+	unsigned int state = v * 747796405u + 2891336453u;
+	unsigned int word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+class RandomStream
+{
+private:
+	unsigned int key_ = 0;		//Identifies the stream
+	unsigned int counter_ = 0;	//Number of values drawn so far
+
+public:
+	RandomStream() {}
+
+	RandomStream(unsigned int x, unsigned int y, unsigned int sample, unsigned int frame)
+	{
+		key_ = pcgHash(x ^ pcgHash(y ^ pcgHash(sample ^ pcgHash(frame))));
+	}
+
+	unsigned int nextUInt()
+	{
+		return pcgHash(key_ ^ pcgHash(counter_++));
+	}
+
+	//Uniform float in [0,1)
+	float nextFloat()
+	{
+		return (nextUInt() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//An independent stream for the i-th ray spawned from this one
+	RandomStream split(unsigned int i)
+	{
+		RandomStream child;
+		child.key_ = pcgHash(key_ ^ pcgHash(counter_ + 0x9E3779B9u * (i + 1)));
+		return child;
+	}
+};
+
+#endif //!H_RANDOM
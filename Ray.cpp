@@ -12,7 +12,7 @@ void Ray::closestPt(std::vector<SceneObject*> &sceneObjects)
 	float tmin = 1.e+6;
     for(int i = 0;  i < sceneObjects.size();  i++)
 	{
-        float t = sceneObjects[i]->intersect(p0, dir);
+        float t = sceneObjects[i]->intersectAt(p0, dir, time);
 		if(t > 0)        //Intersects the object
 		{
 			point = p0 + dir*t;
@@ -28,3 +28,16 @@ void Ray::closestPt(std::vector<SceneObject*> &sceneObjects)
 
 }
 
+//Finds the closest point of intersection using a BVH built over the scene objects.
+//Gives the same result as the version above, with index referring to the same list.
+void Ray::closestPt(BVH& bvh)
+{
+	int i;
+	float t = bvh.closestHit(p0, dir, 1.e+6, time, i);
+	if (i >= 0)
+	{
+		hit = p0 + dir*t;
+		index = i;
+		dist = t;
+	}
+}
@@ -8,6 +8,8 @@
 #define H_RAY
 #include <glm/glm.hpp>
 #include <vector>
+#include "BVH.h"
+#include "Random.h"
 #include "SceneObject.h"
 
 class Ray
@@ -19,6 +21,7 @@ public:
 	glm::vec3 hit = glm::vec3(0);		//The closest point of intersection on the ray
 	int index = -1;						//The index of the object that gives the closet point of intersection
 	float dist = 0;						//The distance from the p0 to hit along the ray.
+	float time = 0;						//Shutter time the ray samples, 0 (open) to 1 (closed)
 
 	Ray() {}		//Default constructor
 
@@ -29,7 +32,34 @@ public:
 		dir = glm::normalize(direction);
 	}
 
+	//For directions already known to be unit length, e.g. reflections of a unit vector
+	Ray(glm::vec3 source, glm::vec3 direction, bool isUnit)
+	{
+		p0 = source;
+#if FAST_MATH_KERNELS
+		dir = isUnit ? direction : glm::normalize(direction);
+#else
+		dir = glm::normalize(direction);
+#endif
+	}
+
 	void closestPt(std::vector<SceneObject*>& sceneObjects);
 
+	void closestPt(BVH& bvh);
+
+};
+
+/**
+ * A ray waiting to be traced, together with its depth and
+ * the share of its colour that ends up in the pixel.
+ */
+struct PendingRay
+{
+	Ray ray;
+	int step = 1;
+	float weight = 1;
+	int pixel = 0;		//Which pixel of the tile the ray belongs to (wavefront mode)
+	RandomStream rng;	//Random numbers for shading this ray's hit
+	float distance = 0;	//Distance travelled before this ray's origin, for texture footprints
 };
 #endif
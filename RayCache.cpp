@@ -0,0 +1,147 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Ray cache
+*  A cell's rays are traced in the same order every time the
+*  settings that decide them are the same, so a lookup first
+*  checks the entry after the last one found. When rays are
+*  added or dropped, it searches the rest of the cell.
+*  Each thread works on one cell at a time, recording into
+*  fresh lists that replace the old ones when the cell ends.
+-------------------------------------------------------------*/
+
+#include "RayCache.h"
+#include <string.h>
+
+template <typename Entry>
+struct CellList
+{
+	std::vector<Entry>* old = nullptr;
+	size_t next = 0;					//Where the following lookup starts
+	std::vector<Entry> fresh;			//This trace's rays, in order
+
+	void begin(std::vector<Entry>* cell)
+	{
+		old = cell;
+		next = 0;
+		fresh.clear();
+	}
+
+	const Entry* find(unsigned long long key)
+	{
+		for (size_t i = next; i < old->size(); i++)
+		{
+			if ((*old)[i].key == key)
+			{
+				next = i + 1;
+				fresh.push_back((*old)[i]);
+				return &fresh.back();
+			}
+		}
+		return nullptr;
+	}
+
+	void end()
+	{
+		old->assign(fresh.begin(), fresh.end());		//Sized to fit, unlike fresh
+		old = nullptr;
+	}
+};
+
+struct CellCursor
+{
+	CellList<CachedHit> hits;
+	CellList<CachedShadow> shadows;
+	long long reused = 0;
+};
+
+static thread_local CellCursor cursor;
+
+void RayCache::reset(int width, int height)
+{
+	width_ = width;
+	hits_.assign(width * height, std::vector<CachedHit>());
+	shadows_.assign(width * height, std::vector<CachedShadow>());
+}
+
+void RayCache::clear()
+{
+	for (size_t i = 0; i < hits_.size(); i++)
+	{
+		std::vector<CachedHit>().swap(hits_[i]);
+		std::vector<CachedShadow>().swap(shadows_[i]);
+	}
+}
+
+/**
+* Mixes the seven floats' bits with the splitmix64 finalizer after each one.
+* With 64 bits, two different rays of one cell colliding is not a concern.
+*/
+unsigned long long RayCache::key(glm::vec3 a, glm::vec3 b, float time)
+{
+	unsigned int bits[7];
+	memcpy(bits, &a, sizeof(float) * 3);
+	memcpy(bits + 3, &b, sizeof(float) * 3);
+	memcpy(bits + 6, &time, sizeof(float));
+	unsigned long long hash = 0;
+	for (int i = 0; i < 7; i++)
+	{
+		hash = (hash ^ bits[i]) + 0x9E3779B97F4A7C15ULL;
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+		hash ^= hash >> 31;
+	}
+	return hash;
+}
+
+void RayCache::beginCell(int x, int y)
+{
+	cursor.hits.begin(&hits_[x * width_ + y]);
+	cursor.shadows.begin(&shadows_[x * width_ + y]);
+	cursor.reused = 0;
+}
+
+void RayCache::endCell()
+{
+	reused_ += cursor.reused;
+	traced_ += cursor.hits.fresh.size() + cursor.shadows.fresh.size() - cursor.reused;
+	cursor.hits.end();
+	cursor.shadows.end();
+}
+
+bool RayCache::lookupHit(unsigned long long key, int& index, float& dist)
+{
+	if (cursor.hits.old == nullptr) return false;
+	const CachedHit* found = cursor.hits.find(key);
+	if (found == nullptr) return false;
+	index = found->index;
+	dist = found->dist;
+	cursor.reused++;
+	return true;
+}
+
+void RayCache::storeHit(unsigned long long key, int index, float dist)
+{
+	if (cursor.hits.old != nullptr) cursor.hits.fresh.push_back({ key, index, dist });
+}
+
+bool RayCache::lookupShadow(unsigned long long key, int& blocker)
+{
+	if (cursor.shadows.old == nullptr) return false;
+	const CachedShadow* found = cursor.shadows.find(key);
+	if (found == nullptr) return false;
+	blocker = found->blocker;
+	cursor.reused++;
+	return true;
+}
+
+void RayCache::storeShadow(unsigned long long key, int blocker)
+{
+	if (cursor.shadows.old != nullptr) cursor.shadows.fresh.push_back({ key, blocker });
+}
+
+void RayCache::takeCounts(long long& reused, long long& traced)
+{
+	reused = reused_.exchange(0);
+	traced = traced_.exchange(0);
+}
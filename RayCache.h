@@ -0,0 +1,80 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Ray cache
+*  Remembers, for every cell of the frame, what each ray
+*  traced for it hit: the object and distance for primary
+*  and secondary rays, and the blocking object, if any, for
+*  shadow rays. Tracing the frame again after a change to
+*  materials or lights looks the same rays up instead of
+*  searching the scene, so only shading is redone. Rays that
+*  changed, such as shadow rays to a light that moved, are
+*  simply not found and are traced as usual.
+*
+*  Rays are matched by a 64-bit hash of their origin and
+*  direction, not by the scene, so the cache must be cleared
+*  whenever geometry changes. Only the depth first tracer
+*  uses the cache.
+-------------------------------------------------------------*/
+
+#ifndef H_RAYCACHE
+#define H_RAYCACHE
+#include <atomic>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct CachedHit
+{
+	unsigned long long key;
+	int index;		//Object hit, -1 for none
+	float dist;
+};
+
+struct CachedShadow
+{
+	unsigned long long key;
+	int blocker;	//Object between the point and the light, -1 for none
+};
+
+class RayCache
+{
+
+private:
+	std::vector<std::vector<CachedHit>> hits_;			//Per cell, in the order the rays were traced
+	std::vector<std::vector<CachedShadow>> shadows_;
+	int width_ = 0;
+	std::atomic<long long> reused_{ 0 };
+	std::atomic<long long> traced_{ 0 };
+
+public:
+	RayCache() {}
+
+	void reset(int width, int height);
+
+	void clear();
+
+	bool enabled() const { return width_ > 0; }
+
+	// Identifies a ray by two vectors, e.g. its origin and direction, and its shutter time.
+	static unsigned long long key(glm::vec3 a, glm::vec3 b, float time);
+
+	// Starts and finishes cell (x, y) on the calling thread. Every ray traced
+	// in between is looked up in, and recorded for, that cell.
+	void beginCell(int x, int y);
+
+	void endCell();
+
+	bool lookupHit(unsigned long long key, int& index, float& dist);
+
+	void storeHit(unsigned long long key, int index, float dist);
+
+	bool lookupShadow(unsigned long long key, int& blocker);
+
+	void storeShadow(unsigned long long key, int blocker);
+
+	// Ray counts since the last call, then starts counting again.
+	void takeCounts(long long& reused, long long& traced);
+
+};
+
+#endif //!H_RAYCACHE
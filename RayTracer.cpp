@@ -10,15 +10,37 @@
 #include <cmath>
 #include <vector>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <GL/freeglut.h>
 #include <thread>
-
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+
+#include "Box.h"
+#include "Accumulator.h"
+#include "BVH.h"
+#include "Checkpoint.h"
 #include "Cylinder.h"
+#include "Distributed.h"
+#include "Group.h"
+#include "HdrImage.h"
+#include "Instance.h"
+#include "LightList.h"
 #include "Noise.h"
+#include "NoiseCache.h"
 #include "Plane.h"
+#include "Quadric.h"
+#include "Random.h"
+#include "RayCache.h"
 #include "Ray.h"
+#include "RectLight.h"
+#include "Renderer.h"
 #include "Sphere.h"
+#include "Scene.h"
 #include "SceneObject.h"
+#include "SolidTexture.h"
 #include "TextureBMP.h"
 #include "Torus.h"
 using namespace std;
@@ -33,6 +55,15 @@ using namespace std;
 #define PI acos(-1)
 #define NOISE_WIDTH 1024
 #define NOISE_HEIGHT 1024
+#define NOISE_SEED 363
+
+// How the marble sphere is textured: a baked 2D table, 2D noise evaluated per
+// hit, or 3D solid marble evaluated at the object-space hit point.
+typedef enum MarbleMode {
+	BakedMarble,
+	ProceduralMarble,
+	SolidMarble
+} MarbleMode;
 
 const bool ENABLE_AA = true;
 const float WIDTH = 40.0;  
@@ -40,49 +71,349 @@ const float HEIGHT = 40.0;
 const float EDIST = 40.0;
 const int NUMDIV = 1024;
 const int MAX_STEPS = 5;
+const int MAX_SHADOW_RAYS = 8;
+const bool ADAPTIVE_SHADOWS = true;
+const float MIN_RAY_WEIGHT = 0.01;
+const int MAX_CHILD_RAYS = 3;
+const int RAY_STACK_SIZE = MAX_CHILD_RAYS * MAX_STEPS;
+const int TILE_SIZE = 32;
+const int PROGRESSIVE_PASS_SAMPLES = 4;		//Samples added to each unconverged pixel per pass
+const int PROGRESSIVE_MIN_SAMPLES = 4;
+const int PROGRESSIVE_MAX_SAMPLES = 64;
+const float PROGRESSIVE_ERROR = 0.01;		//Target standard error of a pixel's luminance
+const float FRAME_TIME = 1 / 24.0;			//Scene time between animation frames, in seconds
+const float SHUTTER = 0.5;					//Share of the frame time the shutter is open, for motion blur
+const float DISPLAY_GAMMA = 2.2;
+const int EXPORT_STRIP_ROWS = 64;			//Rows converted and written to disk at a time
+const float PIXEL_SPREAD = (WIDTH / NUMDIV) / EDIST;	//Pixel width per unit distance from the eye
+const MarbleMode MARBLE_MODE = SolidMarble;
+const float MARBLE_X_PERIOD = 5.0;
+const float MARBLE_Y_PERIOD = 10.0;
+const float MARBLE_TURB_POWER = 2.0;
+const float MARBLE_TURB_SIZE = 128.0;
 const float XMIN = -WIDTH * 0.5;
 const float XMAX =  WIDTH * 0.5;
 const float YMIN = -HEIGHT * 0.5;
 const float YMAX =  HEIGHT * 0.5;
 
-vector<SceneObject*> sceneObjects;
+shared_ptr<Scene> currentScene = make_shared<Scene>();	//The scene shown in the window and saved
 TextureBMP brickAlbedo;
 TextureBMP brickNormal;
 TextureBMP bronzeAlbedo;
 TextureBMP bronzeNormal;
 TextureBMP bronzeMetallic;
 bool traced = false;
+bool wavefrontMode = false;
+string coordinatorAddress;		//Set with --coordinator: farm tiles out to workers
+string workerAddress;			//Set with --worker: render tiles for a coordinator
+string checkpointPath;			//Set with --checkpoint: save finished tiles here and resume from them (not progressive)
+Checkpoint checkpoint;
+bool progressiveMode = false;	//Set with --progressive: sample until pixels converge
+float timeBudget = 0;			//Set with --budget: seconds a progressive frame may take, 0 for no limit
+Accumulator accumulator;
+bool toneMapping = false;		//Set with --tonemap: compress pixels for display instead of clamping them
+float exposure = 1;				//Set with --exposure: scale applied before tone mapping
+string hdrPath;					//Set with --hdr: also save the unclamped frame as .pfm or .exr
+string basePath;				//Set with --base: start from the pixels of a saved .pfm
+Tile renderRegion = { 0, NUMDIV, 0, NUMDIV };	//Set with --region or a mouse drag: the only cells traced
+int dragX, dragY;				//Cell the mouse button went down on
+bool rayCaching = false;		//Set with --ray-cache: reuse ray hits when only materials or lights change (depth first tracing)
+RayCache rayCache;
+bool animating = false;			//Set with --animate: keep moving the scene and tracing new frames
+bool motionBlur = false;		//Set with --motion-blur: spread each pixel's samples over the shutter interval
+float lensRadius = 0;			//Set with --aperture: radius of the thin lens, 0 for a pinhole camera
+float focusDistance = 70;		//Set with --focus: distance in front of the eye that is sharp
+Sphere *bobbingSphere;			//Objects moved by animateScene()
+Instance *spinningCube;
+unsigned int frameNumber = 0;
 bool exported = false;
 glm::vec3 pixels[NUMDIV][NUMDIV];
+unsigned char displayPixels[NUMDIV][NUMDIV][3];	//pixels as shown and saved to the TGA, RGB bytes
 
-float **marbleNoise;
-glm::vec3 marbleColours[NOISE_WIDTH][NOISE_HEIGHT];
+float *marbleNoise;		//NOISE_WIDTH x NOISE_HEIGHT, row by row
+const float *marbleTable;	//Baked marble pattern, same layout as marbleNoise
+SolidTexture marbleSolid;
 
-//---The most important function in a ray tracer! ---------------------------------- 
-//   Computes the colour value obtained by tracing a ray and finding its 
-//     closest point of intersection with objects in the scene.
+//---Marble texture ----------------------------------------------------------------
+//   The marble pattern at texel (x, y), given the turbulence there.
 //----------------------------------------------------------------------------------
-glm::vec3 trace(Ray ray, int step)
+float marbleValue(float x, float y, float turb)
 {
+	float xyValue = x * MARBLE_X_PERIOD / NOISE_WIDTH
+		+ y * MARBLE_Y_PERIOD / NOISE_HEIGHT
+		+ MARBLE_TURB_POWER * turb / 256.0;
+	return fabs(sin(xyValue * PI));
+}
+
+//   Bakes marbleTable. Rows are split between NUM_THREADS threads, and each row's
+//     turbulence is computed in one pass by turbulenceRow().
+//   A table baked with the same parameters by an earlier run is mapped from the
+//     noise cache instead, and a freshly baked one is saved there.
+void generateMarble()
+{
+	if (MARBLE_MODE != BakedMarble) return;
+
+	float params[4] = { MARBLE_X_PERIOD, MARBLE_Y_PERIOD, MARBLE_TURB_POWER, MARBLE_TURB_SIZE };
+	unsigned long long key = noiseCacheKey(params, 4, NOISE_SEED, NOISE_WIDTH, NOISE_HEIGHT);
+	string cachePath = noiseCachePath("marble", key);
+	marbleTable = loadNoiseCache(cachePath.c_str(), key, NOISE_WIDTH, NOISE_HEIGHT);
+	if (marbleTable != nullptr)
+	{
+		cout << "Marble loaded from " << cachePath << endl;
+		return;
+	}
+
+	float *table = new float[NOISE_WIDTH * NOISE_HEIGHT];
+	marbleNoise = new float[NOISE_WIDTH * NOISE_HEIGHT];
+	generateNoise(marbleNoise, NOISE_WIDTH, NOISE_HEIGHT, NOISE_SEED);
+
+	std::thread threads[NUM_THREADS];
+	auto rowFunc = [table](int first, int last)
+	{
+		float turb[NOISE_WIDTH];
+		for (int y = first; y < last; y++)
+		{
+			turbulenceRow(marbleNoise, NOISE_WIDTH, NOISE_HEIGHT, y, MARBLE_TURB_SIZE, turb);
+			for (int x = 0; x < NOISE_WIDTH; x++)
+			{
+				table[y * NOISE_WIDTH + x] = marbleValue(x, y, turb[x]);
+			}
+		}
+	};
+
+	int rows = NOISE_HEIGHT / NUM_THREADS;
+	for (int i = 0; i < NUM_THREADS; i++)
+	{
+		int last = (i == NUM_THREADS - 1) ? NOISE_HEIGHT : (i + 1) * rows;
+		threads[i] = std::thread(rowFunc, i * rows, last);
+	}
+
+	for (int i = 0; i < NUM_THREADS; i++)
+	{
+		threads[i].join();
+	}
+	marbleTable = table;
+
+	if (!saveNoiseCache(cachePath.c_str(), key, NOISE_WIDTH, NOISE_HEIGHT, marbleTable))
+	{
+		cerr << "Could not write noise cache " << cachePath << endl;
+	}
+}
+
+//   Marble at texture coordinates (s, t), either read from marbleTable or, with
+//     ProceduralMarble, evaluated from gradient noise with no table at all.
+float marbleAt(float s, float t)
+{
+	if (MARBLE_MODE == ProceduralMarble)
+	{
+		float x = s * NOISE_WIDTH;
+		float y = NOISE_HEIGHT - t * NOISE_HEIGHT;
+		float turb = gradientTurbulence(x, y, NOISE_WIDTH, NOISE_HEIGHT, MARBLE_TURB_SIZE, NOISE_SEED);
+		return marbleValue(x, y, turb);
+	}
+
+	int xPixel = (int)glm::round(s * NOISE_WIDTH) % NOISE_WIDTH;
+	int yPixel = (NOISE_HEIGHT - (int)glm::round(t * NOISE_HEIGHT)) % NOISE_HEIGHT;
+	return marbleTable[yPixel * NOISE_WIDTH + xPixel];
+}
+
+//---Closest hit of a ray ---------------------------------------------------------
+//   Looks the ray up in the job's ray cache first, if it has one.
+//----------------------------------------------------------------------------------
+void findClosest(Scene& scene, const RenderSettings& settings, Ray& ray)
+{
+	RayCache *cache = settings.rayCache;
+	if (cache == nullptr || !cache->enabled())
+	{
+		ray.closestPt(scene.bvh);
+		return;
+	}
+
+	unsigned long long key = RayCache::key(ray.p0, ray.dir, ray.time);
+	int index;
+	float dist;
+	if (cache->lookupHit(key, index, dist))
+	{
+		if (index < 0) return;
+		ray.index = index;
+		ray.dist = dist;
+		ray.hit = ray.p0 + ray.dir * dist;
+		return;
+	}
+	ray.closestPt(scene.bvh);
+	cache->storeHit(key, ray.index, ray.dist);
+}
+
+//---Shadow ray query --------------------------------------------------------------
+//   Returns how much light from lightPoint reaches hit. Opaque blockers stop
+//     the light entirely, transparent ones tint it with their own colour.
+//     Only the blocker is cached, so changes to its material still show.
+//----------------------------------------------------------------------------------
+glm::vec3 shadowTransmittance(Scene& scene, const RenderSettings& settings, glm::vec3 hit, glm::vec3 lightPoint, float time)
+{
+	int blocker = -1;
+	unsigned long long key = 0;
+	bool cached = false;
+	RayCache *cache = settings.rayCache;
+	if (cache != nullptr && cache->enabled())
+	{
+		key = RayCache::key(hit, lightPoint, time);
+		cached = cache->lookupShadow(key, blocker);
+	}
+	if (!cached)
+	{
+		glm::vec3 lightVec = lightPoint - hit;
+		float lightDist = glm::length(lightVec);
+		Ray shadowRay(hit, lightVec / lightDist, true);
+		shadowRay.time = time;
+		shadowRay.closestPt(scene.bvh);
+		if (shadowRay.index > -1 && shadowRay.dist < lightDist) blocker = shadowRay.index;
+		if (cache != nullptr && cache->enabled()) cache->storeShadow(key, blocker);
+	}
+
+	if (blocker > -1)
+	{
+		SceneObject* hitObject = scene.objects[blocker];
+		if (hitObject->isTransparent() || hitObject->isRefractive())
+		{
+			float coeff = hitObject->getTransparencyCoeff();
+			glm::vec3 hitCol = hitObject->getColor();
+			return coeff * (coeff * glm::vec3(1) + (1 - coeff) * 0.5f * hitCol);
+		}
+		return glm::vec3(0);
+	}
+	return glm::vec3(1);
+}
+
+//---Light sampling -----------------------------------------------------------------
+//   Estimates the light reaching hit from one light, scaled by weight.
+//   Jitter within the strata is drawn from the ray's random stream.
+//   Point lights take a single shadow ray. Area lights take getNumSamples() rays
+//     over a jittered n x n grid of strata on the light. In adaptive mode the four
+//     corner strata are tried first, and the rest are only traced if those four
+//     disagree, i.e. the hit point lies in the penumbra.
+//----------------------------------------------------------------------------------
+LightSample sampleLight(Scene& scene, const RenderSettings& settings, Light* light, glm::vec3 hit, float time,
+	float weight, RandomStream& rng)
+{
+	LightSample sample;
+	sample.position = light->samplePoint(hit, 0.5, 0.5);
+
+	int n = (int)sqrt((float)light->getNumSamples());
+	if (n <= 1)
+	{
+		sample.intensity = weight * light->getRadiance() * shadowTransmittance(scene, settings, hit, sample.position, time);
+		return sample;
+	}
+
+	auto strataSample = [&](int i, int j)
+	{
+		float u = (i + rng.nextFloat()) / n;
+		float v = (j + rng.nextFloat()) / n;
+		return shadowTransmittance(scene, settings, hit, light->samplePoint(hit, u, v), time);
+	};
+
+	glm::vec3 transmitted(0);
+	int taken = 0;
+	if (ADAPTIVE_SHADOWS)
+	{
+		glm::vec3 corners[4] = {
+			strataSample(0, 0), strataSample(n - 1, 0),
+			strataSample(0, n - 1), strataSample(n - 1, n - 1)
+		};
+		transmitted = corners[0] + corners[1] + corners[2] + corners[3];
+		taken = 4;
+		if (corners[0] == corners[1] && corners[0] == corners[2] && corners[0] == corners[3])
+		{
+			sample.intensity = weight * light->getRadiance() * transmitted / (float)taken;
+			return sample;
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			bool corner = (i == 0 || i == n - 1) && (j == 0 || j == n - 1);
+			if (ADAPTIVE_SHADOWS && corner) continue;
+			transmitted += strataSample(i, j);
+			taken++;
+		}
+	}
+	sample.intensity = weight * light->getRadiance() * transmitted / (float)taken;
+	return sample;
+}
+
+//---Light selection ---------------------------------------------------------------
+//   Fills samples with the lights to shade hit with, and returns how many there are.
+//   Small light lists are used in full. Past MAX_SHADOW_RAYS lights, a fixed number
+//     of lights are picked in proportion to their power and weighted by 1 / pdf,
+//     so the number of lights sampled per hit does not grow with the light count.
+//----------------------------------------------------------------------------------
+int gatherLights(Scene& scene, const RenderSettings& settings, glm::vec3 hit, float time, RandomStream& rng,
+	LightSample samples[])
+{
+	int numLights = scene.lights.size();
+	if (numLights <= MAX_SHADOW_RAYS)
+	{
+		for (int i = 0; i < numLights; i++)
+		{
+			samples[i] = sampleLight(scene, settings, scene.lights.get(i), hit, time, 1.0, rng);
+		}
+		return numLights;
+	}
+
+	// Stratify the picks, offset by a random amount so neighbouring
+	// pixels do not all choose the same lights.
+	float jitter = rng.nextFloat();
+	int count = 0;
+	for (int k = 0; k < MAX_SHADOW_RAYS; k++)
+	{
+		float pdf;
+		int i = scene.lights.sample((k + jitter) / MAX_SHADOW_RAYS, pdf);
+		if (i < 0) break;
+		samples[count] = sampleLight(scene, settings, scene.lights.get(i), hit, time, 1.0f / (pdf * MAX_SHADOW_RAYS), rng);
+		count++;
+	}
+	return count;
+}
+
+//---Shades the closest point of intersection ---------------------------------------
+//   Computes the colour at the hit point of a ray that has already been compared
+//     with the scene, scaled by weight. Rather than tracing secondary rays itself,
+//     it writes the reflected, transparent and refracted rays to children (room
+//     for MAX_CHILD_RAYS) with the weight their colour is blended in with. Rays
+//     whose weight falls below MIN_RAY_WEIGHT are dropped, as they can barely
+//     change the pixel. Each child gets its own stream split off from rng.
+//----------------------------------------------------------------------------------
+glm::vec3 shade(Scene& scene, const RenderSettings& settings, PendingRay& current, PendingRay children[], int& numChildren)
+{
+	Ray& ray = current.ray;
+	int step = current.step;
+	float weight = current.weight;
+	RandomStream& rng = current.rng;
+
 	// glm::vec3 backgroundCol(0);						   	//Background colour = (0,0,0)
 	glm::vec3 backgroundCol = colFromBytes(135, 206, 235);	//Background colour = (135,206,235)
-	glm::vec3 lightPos(10, 40, -3);					       	//Light's position
 	glm::vec3 color(0);
 	SceneObject* obj;
-	float ambientLevel = 0.2;
 	float texcoords;
 	float texcoordt;
 
-    ray.closestPt(sceneObjects);					 		//Compare the ray with all objects in the scene
-    if(ray.index == -1) return backgroundCol;		 		//no intersection
-	obj = sceneObjects[ray.index];					 		//object on which the closest point of intersection is found
+    if(ray.index == -1) return weight * backgroundCol;		//no intersection
+	obj = scene.objects[ray.index];					 		//object on which the closest point of intersection is found
 	glm::vec3 baseColor = obj->getColor();
 
-	bool differentColour = false;
-	bool differentNormal = false;
-	bool differentMetallic = false;
-	TextureBMP normalBmp;
-	TextureBMP metallicBmp;
+	HitRecord hit;
+	hit.t = ray.dist;
+	hit.position = ray.hit;
+	hit.object = obj;
+	hit.index = ray.index;
+	hit.time = ray.time;
+	obj->fillHitAt(hit);
+
+	TextureBMP* normalBmp = nullptr;
+	TextureBMP* metallicBmp = nullptr;
 
 	if (ray.index == 0)
 	{
@@ -90,8 +421,6 @@ glm::vec3 trace(Ray ray, int step)
 		int ix = (ray.hit.x < 0 ? -ray.hit.x + BOARD_WIDTH : ray.hit.x) / BOARD_WIDTH;
 		int k = (iz % 2) ^ (ix % 2);
 		baseColor = (k == 0) ? BOARD_PRIMARY_COLOUR : BOARD_SECONDARY_COLOUR;
-
-		differentColour = true;
 	}
 	else if (ray.index == 1)
 	{
@@ -106,239 +435,708 @@ glm::vec3 trace(Ray ray, int step)
 		baseColor = brickAlbedo.getColorAt(texcoords, texcoordt);
 		// baseColor = glm::vec3(0.5);
 
-		differentColour = true;
-		differentNormal = true;
-		normalBmp = brickNormal;
+		normalBmp = &brickNormal;
 	}
 	else if (ray.index == 4)
 	{
 		glm::vec3 origin = glm::vec3(10, 10, -60);
-		glm::vec3 localHit = glm::normalize(ray.hit - origin);
-
-		texcoords = 0.5 + atan2(localHit.x, localHit.z) / (2 * PI); 
-		texcoordt = 0.5 - asin(localHit.y) / PI;
+		float frac;
+		if (MARBLE_MODE == SolidMarble)
+		{
+			float footprint = (current.distance + ray.dist) * PIXEL_SPREAD;
+			frac = marbleSolid.getValueAt(ray.hit - origin, footprint);
+		}
+		else
+		{
+			frac = marbleAt(hit.uv.s, hit.uv.t);
+		}
 		
-		int xPixel = (int)glm::round(texcoords * NOISE_WIDTH);
-		int yPixel = NOISE_HEIGHT - (int)glm::round(texcoordt * NOISE_HEIGHT);
 		// glm::vec3 col1 = colFromBytes(255, 108, 89);
 		// glm::vec3 col2 = colFromBytes(104, 39, 0);
 		glm::vec3 col1 = baseColor;
 		glm::vec3 col2(0, 1, 1);
-		float frac = marbleColours[yPixel][xPixel].r;
 		baseColor = (col1 * frac) + (col2 * (1 - frac));
-		// baseColor = marbleColours[yPixel][xPixel] * baseColor;
-		
-		differentColour = true;
 	}
 	else if (ray.index == 5)
 	{
-		glm::vec3 origin = glm::vec3(-8, -15, -20);
-		float height = 12;
-		float radius = 2;
-		glm::vec3 localHit = ray.hit - origin;
-		glm::vec3 ignoreY = glm::vec3(localHit.x / radius, 0, localHit.z / radius);
-
-		if (localHit.y < height)
+		if (hit.uv.t < 1)		//Side only, the top is left plain
 		{
 			float sScale = 2.0f;
 			float tScale = 2.0f;
-			texcoords = fmod((0.5 + atan2(ignoreY.x, ignoreY.z) / (2 * PI)) * sScale, 1.0);
-			texcoordt = fmod(localHit.y / height * tScale, 1.0);
+			texcoords = fmod(hit.uv.s * sScale, 1.0);
+			texcoordt = fmod(hit.uv.t * tScale, 1.0);
 
 			baseColor = bronzeAlbedo.getColorAt(texcoords, texcoordt);
 			// baseColor = glm::vec3(0.5);
-			differentColour = true;
-			differentNormal = true;
-			differentMetallic = true;
-			normalBmp = bronzeNormal;
-			metallicBmp = bronzeMetallic;
+			normalBmp = &bronzeNormal;
+			metallicBmp = &bronzeMetallic;
 		}
 	}
 
-	if (differentColour)
+	if (normalBmp != nullptr)
 	{
-		if (differentNormal)
-		{
-			color = obj->lighting(lightPos, -ray.dir, ray.hit, baseColor,
-				normalBmp.getColorAt(texcoords, texcoordt));
-		}
-		else
+		hit.shadingNormal = obj->normal(hit, normalBmp->getColorAt(texcoords, texcoordt));
+	}
+
+	LightSample lights[MAX_SHADOW_RAYS];
+	int numLights = gatherLights(scene, settings, ray.hit, ray.time, rng, lights);
+
+	color = obj->lighting(hit, lights, numLights, -ray.dir, baseColor);
+	
+	// Each blend below scales everything accumulated before it, so work out
+	// the final share of the local colour and of each secondary ray up front.
+	bool transparent = obj->isTransparent() && step < MAX_STEPS;
+	bool refractive = obj->isRefractive() && step < MAX_STEPS;
+	float tranCoeff = transparent ? obj->getTransparencyCoeff() : 0;
+	float refrCoeff = refractive ? obj->getRefractionCoeff() : 0;
+	float keep = weight * (1 - tranCoeff) * (1 - refrCoeff);
+
+	auto push = [&](Ray secondary, float rayWeight)
+	{
+		if (rayWeight < MIN_RAY_WEIGHT) return;
+		children[numChildren].ray = secondary;
+		children[numChildren].ray.time = ray.time;
+		children[numChildren].step = step + 1;
+		children[numChildren].weight = rayWeight;
+		children[numChildren].rng = rng.split(numChildren);
+		children[numChildren].distance = current.distance + ray.dist;
+		numChildren++;
+	};
+
+	if (obj->isReflective() && step < MAX_STEPS)
+	{
+		float rho = obj->getReflectionCoeff();
+		if (metallicBmp != nullptr)
 		{
-			color = obj->lighting(lightPos, -ray.dir, ray.hit, baseColor);
+			rho = rho * (metallicBmp->getColorAt(texcoords, texcoordt)).r;
 		}
+		glm::vec3 reflectedDir = glm::reflect(ray.dir, hit.shadingNormal);
+		Ray reflectedRay(ray.hit, reflectedDir, true);
+		push(reflectedRay, keep * rho);
 	}
-	else
+
+	if (transparent)
 	{
-		color = obj->lighting(lightPos, -ray.dir, ray.hit);
+		Ray transparentRay(ray.hit, ray.dir, true);
+		push(transparentRay, weight * tranCoeff * (1 - refrCoeff));
 	}
-	
-	glm::vec3 lightVec = lightPos - ray.hit;
-	Ray shadowRay(ray.hit, lightVec);
-	shadowRay.closestPt(sceneObjects);
-	if (shadowRay.index > -1 && shadowRay.dist < glm::length(lightVec))
+
+	if (refractive)
 	{
-		SceneObject* hitObject = sceneObjects[shadowRay.index];
-		if (hitObject->isTransparent() || hitObject->isRefractive())
+		float eta = 1.0f / obj->getRefractiveIndex();
+		glm::vec3 g = glm::refract(ray.dir, hit.normal, eta);
+		Ray refrRay(ray.hit, g, true);
+
+		// The exit point comes from the object itself, with no scene search.
+		// Planes have no thickness, so the ray carries on in the refracted direction.
+		float tNear, tFar;
+		if (obj->intervalAt(ray.hit, g, ray.time, tNear, tFar) && tFar > 0.001)
 		{
-			glm::vec3 hitCol = hitObject->getColor();
-			color = glm::vec3(
-				hitObject->getTransparencyCoeff() * ((hitObject->getTransparencyCoeff()) *
-					baseColor.r + ((1 - hitObject->getTransparencyCoeff()) * 0.5 * hitCol.r)),
-				hitObject->getTransparencyCoeff() * ((hitObject->getTransparencyCoeff()) *
-					baseColor.g + ((1 - hitObject->getTransparencyCoeff()) * 0.5 * hitCol.g)),
-				hitObject->getTransparencyCoeff() * ((hitObject->getTransparencyCoeff()) *
-					baseColor.b + ((1 - hitObject->getReflectionCoeff()) * 0.5 * hitCol.b)));
+			glm::vec3 exitPt = ray.hit + tFar * refrRay.dir;
+			glm::vec3 m = obj->normalAt(exitPt, ray.time);
+			glm::vec3 h = glm::refract(refrRay.dir, -m, 1.0f / eta);
+
+			Ray finalRay(exitPt, h, true);
+			push(finalRay, weight * refrCoeff);
 		}
 		else
 		{
-			color = glm::vec3(
-				0.2 * baseColor.r,
-				0.2 * baseColor.g,
-				0.2 * baseColor.b);
+			push(refrRay, weight * refrCoeff);
 		}
 	}
 
-	if (obj->isReflective() && step < MAX_STEPS)
+	return keep * color;
+}
+
+//---The most important function in a ray tracer! ---------------------------------- 
+//   Computes the colour value obtained by tracing a ray and finding its 
+//     closest point of intersection with objects in the scene.
+//   Secondary rays are kept on a fixed-size stack instead of recursing, and each
+//     one adds its weighted colour straight into the result.
+//----------------------------------------------------------------------------------
+glm::vec3 trace(Scene& scene, const RenderSettings& settings, Ray ray, int step, RandomStream rng)
+{
+	PendingRay stack[RAY_STACK_SIZE];
+	int top = 0;
+	glm::vec3 color(0);
+
+	stack[top].ray = ray;
+	stack[top].step = step;
+	stack[top].weight = 1.0;
+	stack[top].rng = rng;
+	top++;
+
+	while (top > 0)
 	{
-		float rho = obj->getReflectionCoeff();
-		if (differentMetallic)
-		{
-			rho = rho * (metallicBmp.getColorAt(texcoords, texcoordt)).r;
-		}
-		glm::vec3 normalVec(0);
-		if (differentNormal)
+		top--;
+		PendingRay current = stack[top];
+
+		findClosest(scene, settings, current.ray);		//Compare the ray with all objects in the scene
+		PendingRay children[MAX_CHILD_RAYS];
+		int numChildren = 0;
+		color += shade(scene, settings, current, children, numChildren);
+		for (int i = 0; i < numChildren && top < RAY_STACK_SIZE; i++)
 		{
-			normalVec = obj->normal(ray.hit,
-				normalBmp.getColorAt(texcoords, texcoordt));
+			stack[top++] = children[i];
 		}
-		else
+	}
+
+	return color;
+}
+
+//---Thin lens camera ---------------------------------------------------------------
+//   With a lens radius above zero, a primary ray leaves from a point on the lens
+//     rather than the eye, aimed at where the pinhole ray meets the plane of
+//     focus, so only that plane is sharp. stratum (0 to 3) keeps the lens point
+//     in one quarter of the lens square before it is mapped onto the disk; -1
+//     lets it fall anywhere. The AA samples of a pixel take one stratum each, in
+//     an order that changes from pixel to pixel so the lens and pixel positions
+//     are not tied together.
+//----------------------------------------------------------------------------------
+int lensStratum(const RenderSettings& settings, int x, int y, int k)
+{
+	return (k + pcgHash(x ^ pcgHash(y ^ pcgHash(settings.frame)))) & 3;
+}
+
+// Shirley and Chiu's concentric map from the unit square to the unit disk
+glm::vec2 concentricDisk(float u, float v)
+{
+	float a = 2 * u - 1;
+	float b = 2 * v - 1;
+	if (a == 0 && b == 0) return glm::vec2(0);
+	float r, phi;
+	if (fabs(a) > fabs(b))
+	{
+		r = a;
+		phi = (PI / 4) * (b / a);
+	}
+	else
+	{
+		r = b;
+		phi = (PI / 2) - (PI / 4) * (a / b);
+	}
+	return glm::vec2(r * cos(phi), r * sin(phi));
+}
+
+void applyLens(const RenderSettings& settings, Ray& ray, int stratum, RandomStream& rng)
+{
+	if (settings.lensRadius <= 0) return;
+	float u = rng.nextFloat();
+	float v = rng.nextFloat();
+	if (stratum >= 0)
+	{
+		u = ((stratum & 1) + u) * 0.5f;
+		v = ((stratum >> 1) + v) * 0.5f;
+	}
+	glm::vec2 lens = settings.lensRadius * concentricDisk(u, v);
+	glm::vec3 focus = ray.p0 + ray.dir * (settings.focusDistance / -ray.dir.z);
+	ray.p0 += glm::vec3(lens.x, lens.y, 0);
+	ray.dir = glm::normalize(focus - ray.p0);
+}
+
+//---Primary rays ------------------------------------------------------------------
+//   Writes the primary rays for cell (x, y) to rays and returns how many there are.
+//   Each ray's weight is its share of the pixel colour. Its random stream is keyed
+//     by the cell, sample index and frame, so the image does not depend on how
+//     the work is split between threads. With motion blur, each AA sample takes
+//     a random time in its own quarter of the shutter interval, and with a lens,
+//     a point in its own quarter of the lens. Both are dealt out in per-pixel
+//     orders of their own, so neither the shutter quarter nor the lens quarter
+//     follows the sample's place in the pixel, or each other.
+//----------------------------------------------------------------------------------
+int timeStratum(const RenderSettings& settings, int x, int y, int k)
+{
+	return (k + pcgHash(y ^ pcgHash(x ^ pcgHash(settings.frame ^ 0x68E31DA4u)))) & 3;
+}
+
+int primaryRays(const RenderSettings& settings, int x, int y, PendingRay rays[])
+{
+	float cellX = (XMAX-XMIN)/NUMDIV;  //cell width
+	float cellY = (YMAX-YMIN)/NUMDIV;  //cell height
+	float xp = XMIN + x*cellX;  //grid point
+	float yp = YMIN + y*cellY;
+	glm::vec3 eye(0., 0., 0.);
+
+	if (ENABLE_AA)
+	{
+		float offsets[4][2] = { {0.25, 0.25}, {0.25, 0.75}, {0.75, 0.25}, {0.75, 0.75} };
+		for (int k = 0; k < 4; k++)
 		{
-			normalVec = obj->normal(ray.hit);
+			glm::vec3 dir(xp+offsets[k][0]*cellX, yp+offsets[k][1]*cellY, -EDIST);
+			rays[k].ray = Ray(eye, dir);
+			rays[k].step = 1;
+			rays[k].weight = 0.25;
+			rays[k].rng = RandomStream(x, y, k, settings.frame);
+			if (settings.motionBlur) rays[k].ray.time = (timeStratum(settings, x, y, k) + rays[k].rng.nextFloat()) / 4;
+			applyLens(settings, rays[k].ray, lensStratum(settings, x, y, k), rays[k].rng);
 		}
-		
-		glm::vec3 reflectedDir = glm::reflect(ray.dir, normalVec);
-		Ray reflectedRay(ray.hit, reflectedDir);
-		glm::vec3 reflectedColor = trace(reflectedRay, step + 1);
-		color = color + (rho * reflectedColor);
+		return 4;
 	}
 
-	if (obj->isTransparent() && step < MAX_STEPS)
+	glm::vec3 dir(xp+0.5*cellX, yp+0.5*cellY, -EDIST);
+	rays[0].ray = Ray(eye, dir);
+	rays[0].step = 1;
+	rays[0].weight = 1.0;
+	rays[0].rng = RandomStream(x, y, 0, settings.frame);
+	if (settings.motionBlur) rays[0].ray.time = rays[0].rng.nextFloat();
+	applyLens(settings, rays[0].ray, -1, rays[0].rng);
+	return 1;
+}
+
+//---Primary ray for sample k of cell (x, y) in progressive mode -------------------
+//   The first four samples are the AA grid of primaryRays(), with the same random
+//     streams, so a pixel that converges after them matches the fixed AA image.
+//     Later samples are jittered anywhere in the cell, the shutter and the lens.
+//----------------------------------------------------------------------------------
+PendingRay sampleRay(const RenderSettings& settings, int x, int y, int k)
+{
+	float cellX = (XMAX-XMIN)/NUMDIV;
+	float cellY = (YMAX-YMIN)/NUMDIV;
+	float xp = XMIN + x*cellX;
+	float yp = YMIN + y*cellY;
+	glm::vec3 eye(0., 0., 0.);
+
+	PendingRay sample;
+	sample.rng = RandomStream(x, y, k, settings.frame);
+	float u, v;
+	if (k < 4)
 	{
-		float coeff = obj->getTransparencyCoeff();
-		Ray transparentRay(ray.hit, ray.dir);
-		glm::vec3 transparentColour = trace(transparentRay, step + 1);
-		color = (color * (1 - coeff)) + (coeff * transparentColour);
+		u = (k < 2) ? 0.25 : 0.75;
+		v = (k % 2 == 0) ? 0.25 : 0.75;
 	}
-
-	if (obj->isRefractive() && step < MAX_STEPS)
+	else
 	{
-		float coeff = obj->getRefractionCoeff();
-		float eta = 1.0f / obj->getRefractiveIndex();
-		glm::vec3 n = obj->normal(ray.hit);
-		glm::vec3 g = glm::refract(ray.dir, n, eta);
-		Ray refrRay(ray.hit, g);
-		refrRay.closestPt(sceneObjects);
+		u = sample.rng.nextFloat();
+		v = sample.rng.nextFloat();
+	}
+	sample.ray = Ray(eye, glm::vec3(xp+u*cellX, yp+v*cellY, -EDIST));
+	if (settings.motionBlur)
+	{
+		float jitter = sample.rng.nextFloat();
+		sample.ray.time = (k < 4) ? (timeStratum(settings, x, y, k) + jitter) / 4 : jitter;
+	}
+	applyLens(settings, sample.ray, (k < 4) ? lensStratum(settings, x, y, k) : -1, sample.rng);
+	return sample;
+}
 
-		if (obj->getType() == PlaneObject)
+//---Traces a tile one pixel at a time, writing its colours in tile order ----------
+void traceTile(Scene& scene, const RenderSettings& settings, const Tile& tile, glm::vec3* colours)
+{
+	RayCache *cache = settings.rayCache;
+	bool caching = cache != nullptr && cache->enabled();
+	int tileHeight = tile.y1 - tile.y0;
+	PendingRay rays[4];
+	for (int x = tile.x0; x < tile.x1; x++)
+	{
+		for (int y = tile.y0; y < tile.y1; y++)
 		{
-			if (refrRay.index > -1 && sceneObjects[refrRay.index]->getType() == PlaneObject)
+			if (caching) cache->beginCell(x, y);
+			int n = primaryRays(settings, x, y, rays);
+			glm::vec3 col(0);
+			for (int k = 0; k < n; k++)
 			{
-				if (sceneObjects[refrRay.index]->isRefractive())
-				{
-					glm::vec3 m = obj->normal(refrRay.hit);
-					glm::vec3 h = glm::refract(g, -m, 1.0f / eta);
+				col += rays[k].weight * trace(scene, settings, rays[k].ray, rays[k].step, rays[k].rng);
+			}
+			colours[(x - tile.x0) * tileHeight + (y - tile.y0)] = col;
+			if (caching) cache->endCell();
+		}
+	}
+}
 
-					Ray finalRay(refrRay.hit, h);
-					glm::vec3 refractedColour = trace(finalRay, step + 1);
-					color = (color * (1 - coeff)) + (coeff * refractedColour);
-				}
-				else
-				{
-					glm::vec3 refractedColour = trace(refrRay, step + 1);
-					color = (color * (1 - coeff)) + (coeff * refractedColour);
-				}
+//---Sort key for wavefront ray queues ---------------------------------------------
+//   Groups rays by direction octant first, then by coarse direction, then by
+//     the cell their origin lies in, so rays next to each other in the queue
+//     tend to visit the same objects and texels.
+//----------------------------------------------------------------------------------
+unsigned int rayKey(Ray& ray)
+{
+	unsigned int octant = (ray.dir.x < 0) | ((ray.dir.y < 0) << 1) | ((ray.dir.z < 0) << 2);
+	unsigned int dx = (unsigned int)(fabs(ray.dir.x) * 63) & 63;
+	unsigned int dy = (unsigned int)(fabs(ray.dir.y) * 63) & 63;
+	unsigned int ox = (unsigned int)((int)floor(ray.p0.x / 8.0f) & 31);
+	unsigned int oy = (unsigned int)((int)floor(ray.p0.y / 8.0f) & 31);
+	unsigned int oz = (unsigned int)((int)floor(ray.p0.z / 8.0f) & 31);
+	return (octant << 27) | (dx << 21) | (dy << 15) | (ox << 10) | (oy << 5) | oz;
+}
+
+//---Traces a tile breadth first, writing its colours in tile order ----------------
+//   All primary rays of the tile are intersected as one batch and shaded. The
+//     secondary rays they spawn are sorted with rayKey() and form the next batch,
+//     until no rays are left. Each ray remembers which pixel of the tile it
+//     contributes to. Ray weights start at 1 for each primary ray, as in trace(),
+//     so MIN_RAY_WEIGHT culls the same rays in both modes.
+//----------------------------------------------------------------------------------
+void traceTileWavefront(Scene& scene, const RenderSettings& settings, const Tile& tile, glm::vec3* colours)
+{
+	int x0 = tile.x0, x1 = tile.x1, y0 = tile.y0, y1 = tile.y1;
+	int tileHeight = y1 - y0;
+	vector<glm::vec3> tileColours((x1 - x0) * tileHeight, glm::vec3(0));
+	vector<float> sampleWeights((x1 - x0) * tileHeight);
+	vector<PendingRay> wave;
+	vector<PendingRay> next;
+	vector<unsigned int> keys;
+	vector<int> order;
+
+	PendingRay rays[4];
+	for (int x = x0; x < x1; x++)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			int n = primaryRays(settings, x, y, rays);
+			int pixel = (x - x0) * tileHeight + (y - y0);
+			sampleWeights[pixel] = rays[0].weight;
+			for (int k = 0; k < n; k++)
+			{
+				rays[k].pixel = pixel;
+				rays[k].weight = 1.0;
+				wave.push_back(rays[k]);
 			}
-			else
+		}
+	}
+
+	while (!wave.empty())
+	{
+		for (size_t i = 0; i < wave.size(); i++)
+		{
+			wave[i].ray.closestPt(scene.bvh);
+		}
+
+		next.clear();
+		for (size_t i = 0; i < wave.size(); i++)
+		{
+			PendingRay children[MAX_CHILD_RAYS];
+			int numChildren = 0;
+			PendingRay& current = wave[i];
+			tileColours[current.pixel] += shade(scene, settings, current, children, numChildren);
+			for (int c = 0; c < numChildren; c++)
 			{
-				glm::vec3 refractedColour = trace(refrRay, step + 1);
-				color = (color * (1 - coeff)) + (coeff * refractedColour);
+				children[c].pixel = current.pixel;
+				next.push_back(children[c]);
 			}
 		}
-		else
+
+		keys.resize(next.size());
+		order.resize(next.size());
+		for (size_t i = 0; i < next.size(); i++)
 		{
-			glm::vec3 m = obj->normal(refrRay.hit);
-			glm::vec3 h = glm::refract(g, -m, 1.0f / eta);
+			keys[i] = rayKey(next[i].ray);
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
 
-			Ray finalRay(refrRay.hit, h);
-			glm::vec3 refractedColour = trace(finalRay, step + 1);
-			color = (color * (1 - coeff)) + (coeff * refractedColour);
+		wave.resize(next.size());
+		for (size_t i = 0; i < next.size(); i++)
+		{
+			wave[i] = next[order[i]];
 		}
 	}
 
-	return color;
+	for (int pixel = 0; pixel < tile.numCells(); pixel++)
+	{
+		colours[pixel] = sampleWeights[pixel] * tileColours[pixel];
+	}
+}
+
+//---Tiles of the frame ------------------------------------------------------------
+//   The frame is cut into TILE_SIZE tiles, numbered column by column. Render
+//     jobs, worker processes and the checkpoint all work tile by tile.
+//     Only tiles overlapping renderRegion are made, cut down to fit inside it;
+//     cells outside the region keep whatever pixels already holds.
+//----------------------------------------------------------------------------------
+vector<Tile> frameTiles()
+{
+	return regionTiles(renderRegion, TILE_SIZE);
+}
+
+int tileIndex(const Tile& tile)
+{
+	return regionTileIndex(renderRegion, tile, TILE_SIZE);
+}
+
+//---Limits tracing to the cells [x0, x1) x [y0, y1), clipped to the frame ---------
+void setRenderRegion(int x0, int y0, int x1, int y1)
+{
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, NUMDIV);
+	y1 = std::min(y1, NUMDIV);
+	if (x0 >= x1 || y0 >= y1) renderRegion = { 0, NUMDIV, 0, NUMDIV };
+	else renderRegion = { x0, x1, y0, y1 };
+}
+
+void renderTile(Scene& scene, const RenderSettings& settings, const Tile& tile, glm::vec3* colours)
+{
+	if (settings.wavefront)
+	{
+		traceTileWavefront(scene, settings, tile, colours);
+	}
+	else
+	{
+		traceTile(scene, settings, tile, colours);
+	}
+}
+
+//---The settings the window's frame is traced with, from the command line ------
+RenderSettings currentSettings()
+{
+	RenderSettings settings;
+	settings.region = renderRegion;
+	settings.frame = frameNumber;
+	settings.wavefront = wavefrontMode;
+	settings.motionBlur = motionBlur;
+	settings.lensRadius = lensRadius;
+	settings.focusDistance = focusDistance;
+	settings.rayCache = rayCache.enabled() ? &rayCache : nullptr;
+	return settings;
+}
+
+// Renders a tile of the window's frame with the current settings
+void renderCurrentTile(const Tile& tile, glm::vec3* colours)
+{
+	renderTile(*currentScene, currentSettings(), tile, colours);
+}
+
+void storeTile(const Tile& tile, const glm::vec3* colours)
+{
+	int tileHeight = tile.y1 - tile.y0;
+	for (int x = tile.x0; x < tile.x1; x++)
+	{
+		for (int y = tile.y0; y < tile.y1; y++)
+		{
+			pixels[x][y] = colours[(x - tile.x0) * tileHeight + (y - tile.y0)];
+		}
+	}
+}
+
+//---Keys of the settings that decide the frame's pixels ---------------------------
+//   settingsKey() covers what worker processes must share with the coordinator;
+//     frameKey(), which checkpoints are written with, adds the frame number
+//     and render region.
+//----------------------------------------------------------------------------------
+unsigned long long settingsKey()
+{
+	int settings[] = { NUMDIV, TILE_SIZE, ENABLE_AA, MAX_STEPS, MAX_SHADOW_RAYS, ADAPTIVE_SHADOWS,
+		wavefrontMode, MARBLE_MODE, (int)currentScene->objects.size(), (int)currentScene->lights.size(), motionBlur,
+		(int)(lensRadius * 1000), (int)(focusDistance * 1000), rayCaching };
+	return checkpointKey(settings, sizeof(settings) / sizeof(int));
+}
+
+unsigned long long frameKey()
+{
+	unsigned long long key = settingsKey();
+	int settings[] = { (int)(key >> 32), (int)key, (int)frameNumber,
+		renderRegion.x0, renderRegion.x1, renderRegion.y0, renderRegion.y1 };
+	return checkpointKey(settings, sizeof(settings) / sizeof(int));
+}
+
+//---Opens the checkpoint, if one was asked for, and restores its tiles ------------
+bool openCheckpoint(const vector<Tile>& tiles)
+{
+	if (checkpointPath.empty()) return false;
+	int restored = checkpoint.open(checkpointPath.c_str(), frameKey(), tiles, storeTile);
+	if (restored > 0)
+	{
+		cout << "Resuming from " << checkpointPath << ": " << restored << " of " << tiles.size()
+			<< " tiles already done" << endl;
+	}
+	return true;
+}
+
+//---Render jobs -------------------------------------------------------------------
+//   Every local render goes through one Renderer of NUM_THREADS threads, made on
+//     first use, so frames, progressive passes and tone mapping never start
+//     threads of their own. Code embedding the tracer submits scenes to it with
+//     their own RenderSettings and FrameBuffer; the tracing functions above read
+//     nothing else, so such jobs can overlap each other and the window's frame.
+//----------------------------------------------------------------------------------
+Renderer& renderer()
+{
+	static Renderer pool(NUM_THREADS, TILE_SIZE, renderTile);
+	return pool;
 }
 
 void traceScene()
 {
-	int width = NUMDIV / NUM_THREADS;
+	vector<Tile> tiles = frameTiles();
+	bool checkpointing = openCheckpoint(tiles);
+	vector<Tile> remaining;
+	for (int t = 0; t < (int)tiles.size(); t++)
+	{
+		if (!(checkpointing && checkpoint.isDone(t))) remaining.push_back(tiles[t]);
+	}
 
-	std::thread threads[NUM_THREADS];
-	auto threadFunc = [](int i, int width)
+	RenderSettings settings = currentSettings();
+	shared_ptr<Scene> scene = currentScene;
+	shared_ptr<RenderJob> job = renderer().submit(remaining,
+		[scene, settings](const Tile& tile, glm::vec3* colours) { renderTile(*scene, settings, tile, colours); },
+		[checkpointing](const Tile& tile, const glm::vec3* colours)
+		{
+			storeTile(tile, colours);
+			if (checkpointing) checkpoint.tileDone(tileIndex(tile), colours);
+		});
+	bool complete = job->wait();
+	if (checkpointing) checkpoint.finish(complete);
+
+	if (rayCache.enabled())
 	{
-		float xp, yp;  //grid point
-		float cellX = (XMAX-XMIN)/NUMDIV;  //cell width
-		float cellY = (YMAX-YMIN)/NUMDIV;  //cell height
-		glm::vec3 eye(0., 0., 0.);
+		long long reused, traced;
+		rayCache.takeCounts(reused, traced);
+		cout << "Ray cache: " << reused << " rays reused, " << traced << " traced" << endl;
+	}
+}
+
+//---Progressive rendering ---------------------------------------------------------
+//   Renders in passes. Each pass adds PROGRESSIVE_PASS_SAMPLES samples to every
+//     pixel whose standard error is still above PROGRESSIVE_ERROR, up to
+//     PROGRESSIVE_MAX_SAMPLES, and skips tiles where every pixel has converged.
+//     pixels always holds the current mean, so the frame can be shown or saved
+//     at any time. With a time budget, no new tiles are started once it runs
+//     out; the first pass always completes so every pixel has a value.
+//     Progressive frames are traced locally and not checkpointed: the
+//     accumulator is refined pass after pass rather than tile by tile.
+//----------------------------------------------------------------------------------
+void traceProgressive()
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	auto outOfTime = [&]()
+	{
+		return timeBudget > 0 && std::chrono::duration<float>(Clock::now() - start).count() > timeBudget;
+	};
 
-		// if (i > 1) return;
-		for (int x = (i * width); x < ((i + 1) * width); x++)
+	vector<Tile> tiles = frameTiles();
+	vector<char> tileActive(tiles.size(), 1);
+	accumulator.reset(NUMDIV, NUMDIV);
+	RenderSettings settings = currentSettings();
+	Scene& scene = *currentScene;
+
+	for (int first = 0; first < PROGRESSIVE_MAX_SAMPLES; first += PROGRESSIVE_PASS_SAMPLES)
+	{
+		std::atomic<int> refiningPixels(0);
+		vector<Tile> active;
+		for (int t = 0; t < (int)tiles.size(); t++)
 		{
-			xp = XMIN + x*cellX;
-			for (int y = 0; y < NUMDIV; y++)
-			{
-				yp = YMIN + y*cellY;
+			if (tileActive[t]) active.push_back(tiles[t]);
+		}
+		auto refineTile = [&](const Tile& tile, glm::vec3*)
+		{
+			if (first > 0 && outOfTime()) return;
 
-				if (ENABLE_AA)
-				{
-					glm::vec3 dir1(xp+0.25*cellX, yp+0.25*cellY, -EDIST);
-					glm::vec3 dir2(xp+0.25*cellX, yp+0.75*cellY, -EDIST);
-					glm::vec3 dir3(xp+0.75*cellX, yp+0.25*cellY, -EDIST);
-					glm::vec3 dir4(xp+0.75*cellX, yp+0.75*cellY, -EDIST);
-
-					Ray ray1 = Ray(eye, dir1);
-					Ray ray2 = Ray(eye, dir2);
-					Ray ray3 = Ray(eye, dir3);
-					Ray ray4 = Ray(eye, dir4);
-
-					glm::vec3 col1 = trace (ray1, 1);
-					glm::vec3 col2 = trace (ray2, 1);
-					glm::vec3 col3 = trace (ray3, 1);
-					glm::vec3 col4 = trace (ray4, 1);
-
-					pixels[x][y] = glm::vec3((col1.r + col2.r + col3.r + col4.r) / 4.0,
-											(col1.g + col2.g + col3.g + col4.g) / 4.0,
-											(col1.b + col2.b + col3.b + col4.b) / 4.0);
-				}
-				else
+			int refining = 0;
+			for (int x = tile.x0; x < tile.x1; x++)
+			{
+				for (int y = tile.y0; y < tile.y1; y++)
 				{
-					glm::vec3 dir(xp+0.5*cellX, yp+0.5*cellY, -EDIST);
-					Ray ray = Ray(eye, dir);
-					glm::vec3 col = trace(ray, 1);
-					pixels[x][y] = col;
+					if (accumulator.converged(x, y, PROGRESSIVE_ERROR, PROGRESSIVE_MIN_SAMPLES)) continue;
+					for (int k = first; k < first + PROGRESSIVE_PASS_SAMPLES; k++)
+					{
+						PendingRay sample = sampleRay(settings, x, y, k);
+						accumulator.add(x, y, trace(scene, settings, sample.ray, 1, sample.rng));
+					}
+					pixels[x][y] = accumulator.mean(x, y);
+					if (!accumulator.converged(x, y, PROGRESSIVE_ERROR, PROGRESSIVE_MIN_SAMPLES)) refining++;
 				}
 			}
+			tileActive[tileIndex(tile)] = refining > 0;
+			refiningPixels += refining;
+		};
+		renderer().submit(active, refineTile, nullptr)->wait();
+
+		if (outOfTime())
+		{
+			cout << "Time budget of " << timeBudget << " s used up in pass "
+				<< first / PROGRESSIVE_PASS_SAMPLES + 1 << endl;
+			break;
 		}
-	};
+		cout << "Pass " << first / PROGRESSIVE_PASS_SAMPLES + 1 << ": " << refiningPixels
+			<< " pixels still refining" << endl;
+		if (refiningPixels == 0) break;
+	}
+}
 
-	for (int i = 0; i < NUM_THREADS; i++)
+//---Distributed rendering --------------------------------------------------------
+//   A coordinator serves the tiles to worker processes (see runWorkers()) and
+//     copies their colours into pixels. If the workers all go away, it renders
+//     what is left itself.
+//----------------------------------------------------------------------------------
+//---Renders the frame into pixels, locally or through workers --------------------
+void traceFrame()
+{
+	if (progressiveMode)
 	{
-		threads[i] = std::thread(threadFunc, i, width);
+		traceProgressive();
+		return;
+	}
+	if (coordinatorAddress.empty())
+	{
+		traceScene();
+		return;
 	}
 
-	for (int i = 0; i < NUM_THREADS; i++)
+	vector<Tile> tiles = frameTiles();
+	bool checkpointing = openCheckpoint(tiles);
+	vector<char> done(tiles.size(), 0);
+	vector<Tile> remaining;
+	for (int t = 0; t < (int)tiles.size(); t++)
 	{
-		threads[i].join();
+		if (checkpointing && checkpoint.isDone(t)) done[t] = 1;
+		else remaining.push_back(tiles[t]);
+	}
+
+	bool complete = runCoordinator(coordinatorAddress, NUMDIV, settingsKey(), frameNumber, remaining,
+		[&](const Tile& tile, const glm::vec3* colours)
+		{
+			storeTile(tile, colours);
+			done[tileIndex(tile)] = 1;
+			if (checkpointing) checkpoint.tileDone(tileIndex(tile), colours);
+		});
+	if (!complete)
+	{
+		remaining.clear();
+		for (int t = 0; t < (int)tiles.size(); t++)
+		{
+			if (!done[t]) remaining.push_back(tiles[t]);
+		}
+		cout << "Rendering the remaining " << remaining.size() << " tiles locally" << endl;
+		renderer().submit(remaining, renderCurrentTile, [checkpointing](const Tile& tile, const glm::vec3* colours)
+		{
+			storeTile(tile, colours);
+			if (checkpointing) checkpoint.tileDone(tileIndex(tile), colours);
+		})->wait();
 	}
+	if (checkpointing) checkpoint.finish(true);
+}
+
+//---Display conversion ------------------------------------------------------------
+//   pixels holds linear, unbounded colours. Each row is either clamped to
+//   [0, 1] or tone mapped and gamma corrected, then stored as bytes in
+//   displayPixels. Rows are split into NUM_THREADS strips.
+//----------------------------------------------------------------------------------
+void toneMapRows(int y0, int y1)
+{
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = 0; x < NUMDIV; x++)
+		{
+			glm::vec3 colour = pixels[x][y];
+			if (toneMapping) colour = toneMap(colour, exposure, DISPLAY_GAMMA);
+			for (int c = 0; c < 3; c++)
+			{
+				displayPixels[x][y][c] = clamp(255 * colour[c], 0, 255);
+			}
+		}
+	}
+}
+
+void toneMapFrame()
+{
+	vector<Tile> strips;
+	int strip = (NUMDIV + NUM_THREADS - 1) / NUM_THREADS;
+	for (int y = 0; y < NUMDIV; y += strip)
+	{
+		strips.push_back({ 0, 1, y, min(y + strip, NUMDIV) });
+	}
+	renderer().submit(strips, [](const Tile& tile, glm::vec3*) { toneMapRows(tile.y0, tile.y1); }, nullptr)->wait();
 }
 
 //---The main display module -----------------------------------------------------------
@@ -359,7 +1157,8 @@ void display()
 
 	if (!traced)
 	{
-		traceScene();
+		traceFrame();
+		toneMapFrame();
 		traced = true;
 	}
 
@@ -370,9 +1169,7 @@ void display()
 		{
 			yp = YMIN + j*cellY;
 
-			glColor3f(pixels[i][j].r,
-					  pixels[i][j].g,
-					  pixels[i][j].b);
+			glColor3ubv(displayPixels[i][j]);
 			glVertex2f(xp, yp);				//Draw each cell with its color value
 			glVertex2f(xp+cellX, yp);
 			glVertex2f(xp+cellX, yp+cellY);
@@ -381,104 +1178,219 @@ void display()
     }
 
     glEnd();
+
+	// Outline the render region when it is not the whole frame
+	if (renderRegion.numCells() < NUMDIV * NUMDIV)
+	{
+		glColor3f(1, 1, 0);
+		glBegin(GL_LINE_LOOP);
+		glVertex2f(XMIN + renderRegion.x0 * cellX, YMIN + renderRegion.y0 * cellY);
+		glVertex2f(XMIN + renderRegion.x1 * cellX, YMIN + renderRegion.y0 * cellY);
+		glVertex2f(XMIN + renderRegion.x1 * cellX, YMIN + renderRegion.y1 * cellY);
+		glVertex2f(XMIN + renderRegion.x0 * cellX, YMIN + renderRegion.y1 * cellY);
+		glEnd();
+	}
     glFlush();
 }
 
+//---A unit cube [0,1]^3, a single axis-aligned Box ---------------------------------
+//   Built once and shared by every cube in the scene through Instances.
+//----------------------------------------------------------------------------------
+Box* unitCube()
+{
+	static Box* cube = new Box(glm::vec3(0), glm::vec3(1));
+	return cube;
+}
+
+// The unit cube scaled to 10 x 9.99 x 10, sitting just above the floor, turned by angle about its vertical axis
+glm::mat4 cubeTransform(float angle)
+{
+	glm::mat4 transform = glm::translate(glm::mat4(1), glm::vec3(-10, -14.99, -55));
+	transform = glm::rotate(transform, angle, glm::vec3(0, 1, 0));
+	transform = glm::translate(transform, glm::vec3(-5, 0, -5));
+	return glm::scale(transform, glm::vec3(10, 9.99, 10));
+}
+
 void drawCube()
 {
-	// Draw a cube
-	Plane *cubeBottom = new Plane(glm::vec3(-15, -14.99, -50),
-								  glm::vec3(-5, -14.99, -50),
-								  glm::vec3(-5, -14.99, -60),
-								  glm::vec3(-15, -14.99, -60));
-	cubeBottom->setColor(glm::vec3(1, 0, 0));
-	cubeBottom->setRefractivity(true, 0.5, 1.03);
-	cubeBottom->setReflectivity(true, 0.8);
-	sceneObjects.push_back(cubeBottom);
-	Plane *cubeTop = new Plane(glm::vec3(-15, -5, -50),
-							   glm::vec3(-5, -5, -50),
-							   glm::vec3(-5, -5, -60),
-							   glm::vec3(-15, -5, -60));
-	cubeTop->setColor(glm::vec3(1, 0, 0));
-	cubeTop->setRefractivity(true, 0.5, 1.03);
-	cubeTop->setReflectivity(true, 0.8);
-	sceneObjects.push_back(cubeTop);
-	Plane *cubeBack = new Plane(glm::vec3(-15, -15, -60),
-							   glm::vec3(-5, -15, -60),
-							   glm::vec3(-5, -5, -60),
-							   glm::vec3(-15, -5, -60));
-	cubeBack->setColor(glm::vec3(1, 0, 0));
-	cubeBack->setRefractivity(true, 0.5, 1.03);
-	cubeBack->setReflectivity(true, 0.8);
-	sceneObjects.push_back(cubeBack);
-	Plane *cubeFront = new Plane(glm::vec3(-15, -15, -50),
-							   glm::vec3(-5, -15, -50),
-							   glm::vec3(-5, -5, -50),
-							   glm::vec3(-15, -5, -50));
-	cubeFront->setColor(glm::vec3(1, 0, 0));
-	cubeFront->setRefractivity(true, 0.5, 1.03);
-	cubeFront->setReflectivity(true, 0.8);
-	sceneObjects.push_back(cubeFront);
-	Plane *cubeLeft = new Plane(glm::vec3(-15, -15, -50),
-							   glm::vec3(-15, -15, -60),
-							   glm::vec3(-15, -5, -60),
-							   glm::vec3(-15, -5, -50));
-	cubeLeft->setColor(glm::vec3(1, 0, 0));
-	cubeLeft->setRefractivity(true, 0.5, 1.03);
-	cubeLeft->setReflectivity(true, 0.8);
-	Plane *cubeRight = new Plane(glm::vec3(-5, -15, -50),
-							   glm::vec3(-5, -15, -60),
-							   glm::vec3(-5, -5, -60),
-							   glm::vec3(-5, -5, -50));
-	cubeRight->setColor(glm::vec3(1, 0, 0));
-	cubeRight->setRefractivity(true, 0.5, 1.03);
-	cubeRight->setReflectivity(true, 0.8);
-	sceneObjects.push_back(cubeRight);
+	Instance *cube = new Instance(unitCube(), cubeTransform(0));
+	cube->setColor(glm::vec3(1, 0, 0));
+	cube->setRefractivity(true, 0.5, 1.03);
+	cube->setReflectivity(true, 0.8);
+	currentScene->objects.push_back(cube);
+	spinningCube = cube;
 }
 
-void generateMarble()
+//---Three six-sided crystals growing from one spot ---------------------------------
+//   Each is a hexagonal prism with a pointed top, open at the bottom where it
+//     meets the ground. The faces are built once, in a Group with its own
+//     BVH, and shared by every crystal cluster in the scene through Instances.
+//----------------------------------------------------------------------------------
+Group* crystalCluster()
 {
-	marbleNoise = new float*[NOISE_HEIGHT];
-	
-	for (int i = 0; i < NOISE_HEIGHT; i++)
+	static Group* cluster = nullptr;
+	if (cluster != nullptr) return cluster;
+
+	// Height, radius, lean towards x and lean towards z of each crystal
+	const float crystals[3][4] = { { 6, 1, 0, 0 }, { 4, 0.8, -0.4, 0.2 }, { 3.5, 0.7, 0.35, -0.3 } };
+	vector<SceneObject*> faces;
+	for (int i = 0; i < 3; i++)
 	{
-		marbleNoise[i] = new float[NOISE_WIDTH];
+		float height = crystals[i][0], radius = crystals[i][1];
+		glm::mat4 lean = glm::rotate(glm::mat4(1), crystals[i][2], glm::vec3(0, 0, 1));
+		lean = glm::rotate(lean, crystals[i][3], glm::vec3(1, 0, 0));
+		auto at = [&](float x, float y, float z) { return glm::vec3(lean * glm::vec4(x, y, z, 1)); };
+
+		glm::vec3 apex = at(0, height, 0);
+		glm::vec3 axisPoint = at(0, height * 0.5, 0);
+		for (int k = 0; k < 6; k++)
+		{
+			float a0 = k * M_PI / 3, a1 = (k + 1) * M_PI / 3;
+			glm::vec3 b0 = at(radius * cos(a0), 0, radius * sin(a0));
+			glm::vec3 b1 = at(radius * cos(a1), 0, radius * sin(a1));
+			glm::vec3 t0 = at(radius * cos(a0), height * 0.7, radius * sin(a0));
+			glm::vec3 t1 = at(radius * cos(a1), height * 0.7, radius * sin(a1));
+
+			// Plane's normal is (c - b) x (a - b); wind both faces so it points outwards
+			if (glm::dot(glm::cross(t1 - b1, b0 - b1), b0 - axisPoint) > 0)
+			{
+				faces.push_back(new Plane(b0, b1, t1, t0));
+				faces.push_back(new Plane(t0, t1, apex));
+			}
+			else
+			{
+				faces.push_back(new Plane(t0, t1, b1, b0));
+				faces.push_back(new Plane(apex, t1, t0));
+			}
+		}
 	}
+	cluster = new Group(faces);
+	return cluster;
+}
 
-	generateNoise(marbleNoise, NOISE_WIDTH, NOISE_HEIGHT);
+void drawCrystal(float scale, glm::vec3 base, glm::vec3 colour)
+{
+	glm::mat4 transform = glm::translate(glm::mat4(1), base);
+	Instance *crystal = new Instance(crystalCluster(), glm::scale(transform, glm::vec3(scale)));
+	crystal->setColor(colour);
+	crystal->setReflectivity(true, 0.3);
+	currentScene->objects.push_back(crystal);
+}
 
-	float xPeriod = 5.0;
-	float yPeriod = 10.0;
-	float turbPower = 2.0;
-	float turbSize = 128.0;
-	
-	for (int y = 0; y < NOISE_HEIGHT; y++)
+//---Animation ---------------------------------------------------------------------
+//   animateScene() moves objects to where they are at a given time. With motion
+//     blur, it also gives them the motion they make while the shutter is open,
+//     from time to time + SHUTTER * FRAME_TIME. The BVH is then refit to the new
+//     bounds in O(n) rather than built again, unless the refit tree has become
+//     BVH_REBUILD_RATIO times as costly as a fresh one.
+//----------------------------------------------------------------------------------
+glm::vec3 bobbingCenter(float time)
+{
+	return glm::vec3(5, -2 + 3 * sin(2 * time), -70);
+}
+
+float cubeAngle(float time)
+{
+	return 0.5f * time;
+}
+
+void animateScene(float time)
+{
+	bobbingSphere->setCenter(bobbingCenter(time));
+	spinningCube->setTransform(cubeTransform(cubeAngle(time)));
+	if (motionBlur)
+	{
+		float close = time + SHUTTER * FRAME_TIME;
+		bobbingSphere->setMotion(bobbingCenter(close) - bobbingCenter(time));
+		spinningCube->setMotion(glm::vec3(0), glm::vec3(-10, 0, -55), glm::vec3(0, 1, 0),
+			cubeAngle(close) - cubeAngle(time));		//About the cube's own axis, as in cubeTransform()
+	}
+}
+
+void updateSceneBVH()
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	currentScene->bvh.refit();
+	Clock::time_point refitted = Clock::now();
+	bool rebuild = currentScene->bvh.needsRebuild();
+	if (rebuild) currentScene->bvh.build(currentScene->objects);
+	Clock::time_point end = Clock::now();
+
+	cout << "BVH refit " << std::chrono::duration<float, std::milli>(refitted - start).count() << " ms";
+	if (rebuild) cout << ", rebuilt " << std::chrono::duration<float, std::milli>(end - refitted).count() << " ms";
+	cout << endl;
+	if (rayCache.enabled()) rayCache.clear();		//Cached hits are for the old positions
+}
+
+void nextFrame()
+{
+	frameNumber++;
+	animateScene(frameNumber * FRAME_TIME);
+	updateSceneBVH();
+	traced = false;
+	exported = false;
+	glutPostRedisplay();
+}
+
+//---Worker processes --------------------------------------------------------------
+//   Each worker process opens NUM_THREADS connections to the coordinator, one
+//     per render thread, and renders its tiles with renderTile(), moving the
+//     scene to each tile's frame. Tiles are traced holding sceneLock shared and
+//     the scene is only moved holding it exclusively, so a slow tile from a
+//     dropped connection finishes on the frame it was given before the scene
+//     moves under it.
+//----------------------------------------------------------------------------------
+std::shared_mutex sceneLock;
+
+void renderWorkerTile(int frame, const Tile& tile, glm::vec3* colours)
+{
+	while (true)
 	{
-		for (int x = 0; x < NOISE_WIDTH; x++)
 		{
-			float xyValue = x * xPeriod / NOISE_WIDTH
-				+ y * yPeriod / NOISE_HEIGHT
-				+ turbPower * turbulence(marbleNoise, NOISE_WIDTH, NOISE_HEIGHT, x, y, turbSize) / 256.0;
-    		float sineValue = fabs(sin(xyValue * PI));
-			marbleColours[y][x] = glm::vec3(sineValue);
+			std::shared_lock<std::shared_mutex> reading(sceneLock);
+			if ((int)frameNumber == frame)
+			{
+				renderTile(*currentScene, currentSettings(), tile, colours);
+				return;
+			}
 		}
+		std::unique_lock<std::shared_mutex> writing(sceneLock);
+		if ((int)frameNumber == frame) continue;		//Another connection got there first
+		frameNumber = frame;
+		animateScene(frameNumber * FRAME_TIME);
+		updateSceneBVH();
+	}
+}
+
+void runWorkers()
+{
+	std::thread threads[NUM_THREADS];
+	for (int i = 0; i < NUM_THREADS; i++)
+	{
+		threads[i] = std::thread([]() { runWorker(workerAddress, NUMDIV, settingsKey(), renderWorkerTile); });
+	}
+	for (int i = 0; i < NUM_THREADS; i++)
+	{
+		threads[i].join();
 	}
 }
 
 //---This function initializes the scene ------------------------------------------- 
 //   Specifically, it creates scene objects (spheres, planes, cones, cylinders etc)
 //     and add them to the list of scene objects.
-//   It also initializes the OpenGL orthographc projection matrix for drawing the
-//     the ray traced image.
 //----------------------------------------------------------------------------------
-void initialize()
+void initializeScene()
 {
-    glMatrixMode(GL_PROJECTION);
-    gluOrtho2D(XMIN, XMAX, YMIN, YMAX);
-
-    glClearColor(0, 0, 0, 1);
 	generateMarble();
+	marbleSolid = SolidTexture(MarbleSolid, 0.4, NOISE_SEED);
+	marbleSolid.setPeriod(0.8);
+	marbleSolid.setTurbulence(0.8);
 	
+	RectLight *light = new RectLight(glm::vec3(8, 40, -5), glm::vec3(4, 0, 0), glm::vec3(0, 0, 4));
+	light->setSamples(16);
+	currentScene->lights.add(light);
+
 	brickAlbedo = TextureBMP("textures/brick_albedo.bmp");
 	brickNormal = TextureBMP("textures/brick_normal.bmp");
 	bronzeAlbedo = TextureBMP("textures/bronze_albedo.bmp");
@@ -491,7 +1403,7 @@ void initialize()
 							 glm::vec3(-200, -15, -400));
 	plane->setSpecularity(false);
 	plane->setReflectivity(true, 0.25);
-	sceneObjects.push_back(plane);
+	currentScene->objects.push_back(plane);
 	
 	Plane *brickWall = new Plane(glm::vec3(-200, -15, -150),
 								 glm::vec3(200, -15, -150),
@@ -499,33 +1411,34 @@ void initialize()
 								 glm::vec3(-200, 35, -150));
 	brickWall->setColor(glm::vec3(1, 0.8, 0));
 	brickWall->setSpecularity(false);
-	sceneObjects.push_back(brickWall);
+	currentScene->objects.push_back(brickWall);
 
 	Sphere *sphere1 = new Sphere(glm::vec3(-5.0, 0.0, -90.0), 15.0);
 	sphere1->setColor(glm::vec3(0, 0, 1));   //Set colour to blue
 	sphere1->setReflectivity(true, 0.8);
-	sceneObjects.push_back(sphere1);		 //Add sphere to scene objects
+	currentScene->objects.push_back(sphere1);		 //Add sphere to scene objects
 
 	Sphere *sphere2 = new Sphere(glm::vec3(5, -2, -70), 4.0);
 	sphere2->setColor(glm::vec3(1, 0, 0));
 	sphere2->setRefractivity(true, 0.65, 1.01);
 	sphere2->setReflectivity(true, 0.5);
-	sceneObjects.push_back(sphere2);
+	currentScene->objects.push_back(sphere2);
+	bobbingSphere = sphere2;
 
 	Sphere *sphere3 = new Sphere(glm::vec3(10, 10, -60), 3.0);
 	sphere3->setColor(glm::vec3(0, 0.5, 1));
-	sceneObjects.push_back(sphere3);
+	currentScene->objects.push_back(sphere3);
 
 	Cylinder *cylinder = new Cylinder(glm::vec3(-9, -15, -20), 2, 12);
 	cylinder->setColor(colFromBytes(149, 116, 70));
 	cylinder->setReflectivity(true, 0.2);
-	sceneObjects.push_back(cylinder);
+	currentScene->objects.push_back(cylinder);
 
 	Sphere *sphere4 = new Sphere(glm::vec3(15, -10, -40), 5.0);
 	sphere4->setColor(glm::vec3(0, 1, 0));
 	sphere4->setTransparency(true, 0.8);
 	sphere4->setReflectivity(true, 0.5);
-	sceneObjects.push_back(sphere4);
+	currentScene->objects.push_back(sphere4);
 
 	drawCube();
 
@@ -533,64 +1446,121 @@ void initialize()
 	torus->setColor(glm::vec3(0, 0.2, 0));
 	// torus->setRefractivity(true, 0.5, 1.5);
 	torus->setReflectivity(true, 0.4);
-	sceneObjects.push_back(torus);
-	
-	// drawCrystal(1.0f, glm::vec3(-7.5, -15, -35), colFromBytes(255, 0, 255));
+	currentScene->objects.push_back(torus);
+
+	Quadric *cone = Quadric::cone(glm::vec3(24, -5, -75), glm::vec3(0, -1, 0), 0.35, 10);
+	cone->setColor(glm::vec3(0.8, 0.6, 0.1));
+	cone->setReflectivity(true, 0.3);
+	currentScene->objects.push_back(cone);
+
+	drawCrystal(1.0f, glm::vec3(-7.5, -15, -35), colFromBytes(255, 0, 255));
+
+	if (motionBlur) animateScene(frameNumber * FRAME_TIME);		//Sets the objects' motion over the first frame's shutter
+	currentScene->bvh.build(currentScene->objects);
+	if (rayCaching) rayCache.reset(NUMDIV, NUMDIV);		//Hits from any earlier scene no longer apply
+}
+
+//---Fills pixels from the .pfm given with --base ---------------------------------
+//   Lets a render region be traced on top of an earlier full render.
+//----------------------------------------------------------------------------------
+void loadBasePixels()
+{
+	if (basePath.empty()) return;
+	bool loaded = readPfm(basePath.c_str(), NUMDIV, NUMDIV, [](int y, const glm::vec3* row)
+	{
+		for (int x = 0; x < NUMDIV; x++) pixels[x][y] = row[x];
+	});
+	if (loaded) cout << "Starting from " << basePath << endl;
+	else cerr << "Cannot read " << basePath << " as a " << NUMDIV << " x " << NUMDIV << " PFM" << endl;
+}
+
+//---Initializes the OpenGL orthographc projection matrix for drawing the ----------
+//     the ray traced image, then the scene.
+//----------------------------------------------------------------------------------
+void initialize()
+{
+    glMatrixMode(GL_PROJECTION);
+    gluOrtho2D(XMIN, XMAX, YMIN, YMAX);
+
+    glClearColor(0, 0, 0, 1);
+	initializeScene();
+	loadBasePixels();
 }
 
+//---Writes displayPixels to render_output.tga -------------------------------------
+//   The image is converted and written EXPORT_STRIP_ROWS rows at a time, so
+//   only one strip is ever held in memory besides the frame itself.
+//----------------------------------------------------------------------------------
 void exportTga()
 {
 	const int width = NUMDIV;
 	const int height = NUMDIV;
 	const int headerLen = 18;
 	const short int bpp = 24;
-	const int pixelBytes = width * height * (bpp / 8);
 	
-	// file format in little endian, assumes host machine is big endian
+	// file format in little endian, written a byte at a time so the host's byte order does not matter
 
-	static unsigned char bytes[headerLen + pixelBytes];
+	unsigned char header[headerLen] = {};
 
-	bytes[2] = 2; // Image type (uncompressed true color)
+	header[2] = 2; // Image type (uncompressed true color)
 
 	// Image specification
-	bytes[8] = width & 0xFF;			// X-Origin
-	bytes[9] = (width >> 8) & 0xFF;		// X-Origin
-	bytes[10] = height & 0xFF;			// Y-Origin
-	bytes[11] = (height >> 8) & 0xFF;	// Y-Origin
-	bytes[12] = width & 0xFF;			// Width
-	bytes[13] = (width >> 8) & 0xFF;	// Width
-	bytes[14] = height & 0xFF;			// Height
-	bytes[15] = (height >> 8) & 0xFF;	// Height
-	bytes[16] = bpp;					// Pixel depth (bytes per pixel)
-	bytes[17] = 0;						// Image descriptor
-	int p = 18;
-	for (int y = 0; y < height; y++)
-	{
-		for (int x = 0; x < width; x++)
-		{
-			glm::vec3 pixel = pixels[x][y];
-			bytes[p] = clamp(255 * pixel.b, 0, 255);
-			p++;
-			bytes[p] = clamp(255 * pixel.g, 0, 255);
-			p++;
-			bytes[p] = clamp(255 * pixel.r, 0, 255);
-			p++;
-		}
-	}
-
-	cout << "Filled pixel data" << endl;
-
+	header[8] = width & 0xFF;			// X-Origin
+	header[9] = (width >> 8) & 0xFF;	// X-Origin
+	header[10] = height & 0xFF;			// Y-Origin
+	header[11] = (height >> 8) & 0xFF;	// Y-Origin
+	header[12] = width & 0xFF;			// Width
+	header[13] = (width >> 8) & 0xFF;	// Width
+	header[14] = height & 0xFF;			// Height
+	header[15] = (height >> 8) & 0xFF;	// Height
+	header[16] = bpp;					// Pixel depth (bytes per pixel)
+	header[17] = 0;						// Image descriptor
+
+	toneMapFrame();
 
 	FILE *writePtr;
 
 	writePtr = fopen("render_output.tga", "wb");
+	if (writePtr == nullptr)
+	{
+		cerr << "Cannot write render_output.tga" << endl;
+		return;
+	}
 	cout << "Opened file for write" << endl;
-	fwrite(bytes, sizeof(bytes), 1, writePtr);
+	fwrite(header, sizeof(header), 1, writePtr);
+
+	static unsigned char strip[EXPORT_STRIP_ROWS * NUMDIV * 3];
+	for (int y0 = 0; y0 < height; y0 += EXPORT_STRIP_ROWS)
+	{
+		int y1 = min(y0 + EXPORT_STRIP_ROWS, height);
+		int p = 0;
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				strip[p++] = displayPixels[x][y][2];
+				strip[p++] = displayPixels[x][y][1];
+				strip[p++] = displayPixels[x][y][0];
+			}
+		}
+		fwrite(strip, 1, p, writePtr);
+	}
 	cout << "Wrote file" << endl;
 	fclose(writePtr);
 	cout << "Closed file stream" << endl;
 }
 
+//---Writes the unclamped frame to hdrPath, a row at a time ------------------------
+void exportHdr()
+{
+	bool written = writeHdr(hdrPath.c_str(), NUMDIV, NUMDIV, [](int y, glm::vec3* row)
+	{
+		for (int x = 0; x < NUMDIV; x++) row[x] = pixels[x][y];
+	});
+	if (written) cout << "Wrote " << hdrPath << endl;
+	else cerr << "Cannot write " << hdrPath << endl;
+}
+
 void keyboard(unsigned char key, int x, int y)
 {
 	if (key == ' ' )
@@ -598,12 +1568,93 @@ void keyboard(unsigned char key, int x, int y)
 		if (!exported)
 		{
 			exportTga();
+			if (!hdrPath.empty()) exportHdr();
 			exported = true;
 		}
 	}
+	else if (key == 'r')
+	{
+		// Trace again, e.g. after changing materials; the ray cache makes this quick
+		traced = false;
+		exported = false;
+		glutPostRedisplay();
+	}
+}
+
+//---Render region from the mouse ------------------------------------------------
+//   Dragging out a rectangle with the left button re-traces only the cells
+//     inside it; a click without a drag re-traces the whole frame.
+//----------------------------------------------------------------------------------
+void mouse(int button, int state, int x, int y)
+{
+	if (button != GLUT_LEFT_BUTTON) return;
+	int cellX = x * NUMDIV / glutGet(GLUT_WINDOW_WIDTH);
+	int cellY = (glutGet(GLUT_WINDOW_HEIGHT) - 1 - y) * NUMDIV / glutGet(GLUT_WINDOW_HEIGHT);	//Window y runs down
+	if (state == GLUT_DOWN)
+	{
+		dragX = cellX;
+		dragY = cellY;
+		return;
+	}
+
+	if (cellX == dragX && cellY == dragY) setRenderRegion(0, 0, NUMDIV, NUMDIV);
+	else setRenderRegion(min(dragX, cellX), min(dragY, cellY), max(dragX, cellX) + 1, max(dragY, cellY) + 1);
+	traced = false;
+	exported = false;
+	glutPostRedisplay();
 }
 
 int main(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--wavefront") wavefrontMode = true;
+		if (arg == "--coordinator" && i + 1 < argc) coordinatorAddress = argv[++i];
+		if (arg == "--worker" && i + 1 < argc) workerAddress = argv[++i];
+		if (arg == "--checkpoint" && i + 1 < argc) checkpointPath = argv[++i];
+		if (arg == "--progressive") progressiveMode = true;
+		if (arg == "--budget" && i + 1 < argc) timeBudget = atof(argv[++i]);
+		if (arg == "--tonemap") toneMapping = true;
+		if (arg == "--exposure" && i + 1 < argc) exposure = atof(argv[++i]);
+		if (arg == "--hdr" && i + 1 < argc) hdrPath = argv[++i];
+		if (arg == "--base" && i + 1 < argc) basePath = argv[++i];
+		if (arg == "--ray-cache") rayCaching = true;
+		if (arg == "--animate") animating = true;
+		if (arg == "--motion-blur") motionBlur = true;
+		if (arg == "--aperture" && i + 1 < argc) lensRadius = atof(argv[++i]);
+		if (arg == "--focus" && i + 1 < argc) focusDistance = atof(argv[++i]);
+		if (arg == "--region" && i + 4 < argc)
+		{
+			int x0 = atoi(argv[i + 1]), y0 = atoi(argv[i + 2]), x1 = atoi(argv[i + 3]), y1 = atoi(argv[i + 4]);
+			setRenderRegion(x0, y0, x1, y1);
+			i += 4;
+		}
+	}
+	if (rayCaching && (wavefrontMode || progressiveMode))
+	{
+		cerr << "--ray-cache only works with the depth first tracer; ignoring it" << endl;
+		rayCaching = false;
+	}
+	if (progressiveMode && !checkpointPath.empty())
+	{
+		cerr << "--checkpoint does not work with --progressive; ignoring it" << endl;
+		checkpointPath.clear();
+	}
+	if (progressiveMode && !coordinatorAddress.empty())
+	{
+		cerr << "--coordinator does not work with --progressive; ignoring it" << endl;
+		coordinatorAddress.clear();
+	}
+	cout << "Tracing " << (wavefrontMode ? "breadth first (wavefront)" : "depth first") << endl;
+
+	// Workers have no window: they set up the scene, serve tiles and exit
+	if (!workerAddress.empty())
+	{
+		initializeScene();
+		runWorkers();
+		return 0;
+	}
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB );
     glutInitWindowSize(NUMDIV, NUMDIV);
@@ -612,6 +1663,8 @@ int main(int argc, char *argv[]) {
 
     glutDisplayFunc(display);
 	glutKeyboardFunc(keyboard);
+	glutMouseFunc(mouse);
+	if (animating) glutIdleFunc(nextFrame);
     initialize();
 
     glutMainLoop();
@@ -0,0 +1,18 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The rectangular area light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#include "RectLight.h"
+
+/**
+* Maps (u, v) linearly across the two edges, so a stratified
+* (u, v) grid gives stratified points on the light.
+*/
+glm::vec3 RectLight::samplePoint(glm::vec3 from, float u, float v)
+{
+	return corner + u * edgeU + v * edgeV;
+}
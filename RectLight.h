@@ -0,0 +1,35 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The rectangular area light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#ifndef H_RECTLIGHT
+#define H_RECTLIGHT
+#include <glm/glm.hpp>
+#include "Light.h"
+
+/**
+ * Defines a parallelogram shaped light with one corner at 'corner'
+ * spanned by the edge vectors 'edgeU' and 'edgeV'
+ */
+class RectLight : public Light
+{
+
+private:
+	glm::vec3 corner = glm::vec3(0);
+	glm::vec3 edgeU = glm::vec3(1, 0, 0);
+	glm::vec3 edgeV = glm::vec3(0, 0, 1);
+
+public:
+	RectLight() { this->type_ = RectLightType; }
+
+	RectLight(glm::vec3 c, glm::vec3 u, glm::vec3 v) : corner(c), edgeU(u), edgeV(v) { this->type_ = RectLightType; }
+
+	glm::vec3 samplePoint(glm::vec3 from, float u, float v);
+
+};
+
+#endif //!H_RECTLIGHT
@@ -0,0 +1,190 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Render jobs on a shared thread pool
+*  All job state is guarded by the Renderer's lock. Tiles
+*  are rendered, stored and reported with the lock released.
+*  A job is finished, and its future set, by whichever call
+*  first sees it with no tiles left to start and none being
+*  rendered.
+-------------------------------------------------------------*/
+
+#include "Renderer.h"
+#include <algorithm>
+
+RenderJob::RenderJob(Renderer *owner, const std::vector<Tile>& tiles, TileRenderer render, TileSink store,
+	ProgressCallback progress, int priority)
+	: owner_(owner), tiles_(tiles), render_(render), store_(store), progress_(progress), priority_(priority)
+{
+	result_ = promise_.get_future().share();
+}
+
+void RenderJob::cancel()
+{
+	std::vector<std::shared_ptr<RenderJob>> finished;
+	{
+		std::lock_guard<std::mutex> guard(owner_->lock_);
+		cancelled_ = true;
+		for (size_t i = 0; i < owner_->jobs_.size(); i++)
+		{
+			if (owner_->jobs_[i].get() == this)
+			{
+				owner_->finishIfDone(owner_->jobs_[i], finished);
+				break;
+			}
+		}
+	}
+	for (size_t i = 0; i < finished.size(); i++) finished[i]->promise_.set_value(false);
+}
+
+void RenderJob::setPriority(int priority)
+{
+	std::lock_guard<std::mutex> guard(owner_->lock_);
+	priority_ = priority;
+}
+
+int RenderJob::tilesDone()
+{
+	std::lock_guard<std::mutex> guard(owner_->lock_);
+	return done_;
+}
+
+Renderer::Renderer(int numThreads, int tileSize, SceneTracer tracer) : tileSize_(tileSize), tracer_(tracer)
+{
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads_.push_back(std::thread(&Renderer::workLoop, this));
+	}
+}
+
+/**
+* Cancels whatever is still queued, lets the tiles being rendered finish,
+* and stops the threads.
+*/
+Renderer::~Renderer()
+{
+	std::vector<std::shared_ptr<RenderJob>> jobs;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		jobs = jobs_;
+	}
+	for (size_t i = 0; i < jobs.size(); i++) jobs[i]->cancel();
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (size_t i = 0; i < threads_.size(); i++) threads_[i].join();
+}
+
+std::shared_ptr<RenderJob> Renderer::submit(std::shared_ptr<Scene> scene, const RenderSettings& settings,
+	std::shared_ptr<FrameBuffer> output, ProgressCallback progress, int priority)
+{
+	RenderSettings job = settings;
+	Tile& region = job.region;
+	if (region.x0 >= region.x1 || region.y0 >= region.y1) region = { 0, output->width, 0, output->height };
+	region.x0 = std::max(region.x0, 0);
+	region.y0 = std::max(region.y0, 0);
+	region.x1 = std::min(region.x1, output->width);
+	region.y1 = std::min(region.y1, output->height);
+
+	SceneTracer tracer = tracer_;
+	TileRenderer render = [scene, job, tracer](const Tile& tile, glm::vec3* colours)
+	{
+		tracer(*scene, job, tile, colours);
+	};
+	TileSink store = [output](const Tile& tile, const glm::vec3* colours)
+	{
+		int tileHeight = tile.y1 - tile.y0;
+		for (int x = tile.x0; x < tile.x1; x++)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				output->at(x, y) = colours[(x - tile.x0) * tileHeight + (y - tile.y0)];
+			}
+		}
+	};
+	if (region.x0 >= region.x1 || region.y0 >= region.y1) return submit(std::vector<Tile>(), render, store, progress, priority);
+	return submit(regionTiles(region, tileSize_), render, store, progress, priority);
+}
+
+std::shared_ptr<RenderJob> Renderer::submit(const std::vector<Tile>& tiles, TileRenderer render, TileSink store,
+	ProgressCallback progress, int priority)
+{
+	std::shared_ptr<RenderJob> job = std::make_shared<RenderJob>(this, tiles, render, store, progress, priority);
+	if (tiles.empty())
+	{
+		job->promise_.set_value(true);
+		return job;
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		jobs_.push_back(job);
+	}
+	wake_.notify_all();
+	return job;
+}
+
+// The job a free thread should take its next tile from, or none. Called with the lock held.
+std::shared_ptr<RenderJob> Renderer::nextJob()
+{
+	std::shared_ptr<RenderJob> best;
+	for (size_t i = 0; i < jobs_.size(); i++)
+	{
+		RenderJob& job = *jobs_[i];
+		if (job.cancelled_ || job.next_ >= job.tiles_.size()) continue;
+		if (best == nullptr || job.priority_ > best->priority_) best = jobs_[i];
+	}
+	return best;
+}
+
+// Removes the job once nothing more will happen to it. Called with the lock held.
+void Renderer::finishIfDone(std::shared_ptr<RenderJob> job, std::vector<std::shared_ptr<RenderJob>>& finished)
+{
+	bool started = job->cancelled_ || job->next_ >= job->tiles_.size();
+	if (!started || job->rendering_ > 0) return;
+	for (size_t i = 0; i < jobs_.size(); i++)
+	{
+		if (jobs_[i] == job)
+		{
+			jobs_.erase(jobs_.begin() + i);
+			finished.push_back(job);
+			return;
+		}
+	}
+}
+
+void Renderer::workLoop()
+{
+	std::vector<glm::vec3> colours;
+	std::unique_lock<std::mutex> guard(lock_);
+	while (true)
+	{
+		std::shared_ptr<RenderJob> job;
+		wake_.wait(guard, [&]() { return stopping_ || (job = nextJob()) != nullptr; });
+		if (job == nullptr) return;
+
+		const Tile& tile = job->tiles_[job->next_++];
+		job->rendering_++;
+		guard.unlock();
+
+		colours.resize(tile.numCells());
+		job->render_(tile, colours.data());
+		if (job->store_) job->store_(tile, colours.data());
+
+		guard.lock();
+		job->rendering_--;
+		int done = ++job->done_;
+		int total = job->tiles_.size();
+		std::vector<std::shared_ptr<RenderJob>> finished;
+		finishIfDone(job, finished);
+		guard.unlock();
+
+		if (job->progress_) job->progress_(done, total);
+		for (size_t i = 0; i < finished.size(); i++)
+		{
+			finished[i]->promise_.set_value(finished[i]->done_ == total);
+		}
+		guard.lock();
+	}
+}
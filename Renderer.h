@@ -0,0 +1,141 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Render jobs on a shared thread pool
+*  A job traces a scene with its own settings into its own
+*  frame buffer. Jobs are submitted to a Renderer, whose
+*  threads take tiles one at a time from the job with the
+*  highest priority (the earliest submitted among equals),
+*  so overlapping jobs share the same threads and a job can
+*  be cancelled or reprioritised between tiles.
+*
+*  Lower down, a job is any list of tiles with the function
+*  that renders a tile and the one that receives its colours.
+*  Tile renderers run on the Renderer's threads and must not
+*  wait on another job of the same Renderer.
+-------------------------------------------------------------*/
+
+#ifndef H_RENDERER
+#define H_RENDERER
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RayCache.h"
+#include "Scene.h"
+#include "Tile.h"
+
+/**
+ * How a job traces its scene, and which part of the frame. The job keeps
+ * its own copy, so the caller's can change while it runs.
+ */
+struct RenderSettings
+{
+	Tile region = { 0, 0, 0, 0 };		//Cells traced, the rest of the output is left alone; empty for all of it
+	unsigned int frame = 0;				//Keys the random streams
+	bool wavefront = false;				//Breadth first tracing
+	bool motionBlur = false;
+	float lensRadius = 0;				//0 for a pinhole camera
+	float focusDistance = 70;
+	RayCache *rayCache = nullptr;		//Optional, for depth first tracing; one job at a time
+};
+
+/**
+ * A frame's colours, stored column by column like a tile's.
+ */
+struct FrameBuffer
+{
+	int width, height;
+	std::vector<glm::vec3> pixels;
+
+	FrameBuffer(int w, int h) : width(w), height(h), pixels((size_t)w * h, glm::vec3(0)) {}
+
+	glm::vec3& at(int x, int y) { return pixels[(size_t)x * height + y]; }
+};
+
+// Traces one tile of a scene, writing its colours in tile order.
+typedef std::function<void(Scene& scene, const RenderSettings& settings, const Tile& tile, glm::vec3* colours)> SceneTracer;
+
+// Called on a render thread after each tile is stored, with the tiles done so far.
+typedef std::function<void(int done, int total)> ProgressCallback;
+
+class Renderer;
+
+class RenderJob
+{
+	friend class Renderer;
+
+private:
+	Renderer *owner_;
+	std::vector<Tile> tiles_;
+	TileRenderer render_;
+	TileSink store_;
+	ProgressCallback progress_;
+	int priority_;
+	size_t next_ = 0;				//Next tile to hand out
+	int rendering_ = 0;				//Tiles being rendered right now
+	int done_ = 0;
+	bool cancelled_ = false;
+	std::promise<bool> promise_;
+	std::shared_future<bool> result_;
+
+public:
+	RenderJob(Renderer *owner, const std::vector<Tile>& tiles, TileRenderer render, TileSink store,
+		ProgressCallback progress, int priority);
+
+	// Becomes true once every tile is stored, or false if the job was cancelled first.
+	std::shared_future<bool> result() { return result_; }
+
+	bool wait() { return result_.get(); }
+
+	// No more tiles are started; tiles already being rendered are still stored.
+	void cancel();
+
+	void setPriority(int priority);
+
+	int tilesDone();
+
+	int numTiles() { return tiles_.size(); }
+
+};
+
+class Renderer
+{
+	friend class RenderJob;
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex lock_;
+	std::condition_variable wake_;
+	std::vector<std::shared_ptr<RenderJob>> jobs_;	//Unfinished jobs, in the order submitted
+	bool stopping_ = false;
+	int tileSize_;
+	SceneTracer tracer_;
+
+	void workLoop();
+
+	std::shared_ptr<RenderJob> nextJob();
+
+	void finishIfDone(std::shared_ptr<RenderJob> job, std::vector<std::shared_ptr<RenderJob>>& finished);
+
+public:
+	// Scene jobs are cut into tiles of tileSize cells and traced with tracer.
+	Renderer(int numThreads, int tileSize, SceneTracer tracer);
+
+	~Renderer();
+
+	// Traces settings.region of scene into output, or all of output if the
+	// region is empty. The region is clipped to output, and a job left with
+	// nothing to trace is done at once. The job holds on to scene and output
+	// until it is destroyed.
+	std::shared_ptr<RenderJob> submit(std::shared_ptr<Scene> scene, const RenderSettings& settings,
+		std::shared_ptr<FrameBuffer> output, ProgressCallback progress = nullptr, int priority = 0);
+
+	std::shared_ptr<RenderJob> submit(const std::vector<Tile>& tiles, TileRenderer render, TileSink store,
+		ProgressCallback progress = nullptr, int priority = 0);
+
+};
+
+#endif //!H_RENDERER
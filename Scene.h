@@ -0,0 +1,24 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The scene
+*  The objects, their BVH and the lights that render jobs
+*  trace. A scene can be shared by any number of jobs, but
+*  must not be changed while any of them is running.
+-------------------------------------------------------------*/
+
+#ifndef H_SCENE
+#define H_SCENE
+#include <vector>
+#include "BVH.h"
+#include "LightList.h"
+#include "SceneObject.h"
+
+struct Scene
+{
+	std::vector<SceneObject*> objects;
+	BVH bvh;				//Built over objects once they are all added
+	LightList lights;
+};
+
+#endif //!H_SCENE
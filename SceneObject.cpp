@@ -8,88 +8,179 @@
 -------------------------------------------------------------*/
 
 #include "SceneObject.h"
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <vector>
+
+/**
+* Finds the span of the object along the ray: tNear is where the ray enters
+* (<= 0 if p0 is already inside) and tFar where it leaves. Returns false if
+* the ray misses. A thin surface gives tNear == tFar.
+* This generic version walks along the ray with intersect(), using the normal
+* to tell an entry from an exit. Convex solids override it with a closed form.
+*/
+bool SceneObject::interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar)
+{
+	float t1 = intersect(p0, dir);
+	if (t1 < 0) return false;
+	glm::vec3 q = p0 + t1 * dir;
+	if (glm::dot(normal(q), dir) > 0)
+	{
+		tNear = 0;
+		tFar = t1;
+		return true;
+	}
+	tNear = tFar = t1;
+	float t2 = intersect(q, dir);
+	if (t2 > 0) tFar = t1 + t2;
+	return true;
+}
+
+bool SceneObject::intervalAt(glm::vec3 p0, glm::vec3 dir, float time, float& tNear, float& tFar)
+{
+	if (!moving_) return interval(p0, dir, tNear, tFar);
+	return interval(motion_.pointToOpen(p0, time), motion_.vectorToOpen(dir, time), tNear, tFar);
+}
+
+glm::vec3 SceneObject::normalAt(glm::vec3 pos, float time)
+{
+	if (!moving_) return normal(pos);
+	return motion_.vectorFromOpen(normal(motion_.pointToOpen(pos, time)), time);
+}
+
+/**
+* fillHit() at the hit's shutter time. The object fills the record where it
+* was when the shutter opened, and its directions are turned back to match.
+*/
+void SceneObject::fillHitAt(HitRecord& hit)
+{
+	if (!moving_)
+	{
+		fillHit(hit);
+		return;
+	}
+	glm::vec3 worldPos = hit.position;
+	hit.position = motion_.pointToOpen(worldPos, hit.time);
+	fillHit(hit);
+	hit.position = worldPos;
+	hit.normal = motion_.vectorFromOpen(hit.normal, hit.time);
+	hit.shadingNormal = motion_.vectorFromOpen(hit.shadingNormal, hit.time);
+	hit.dpdu = motion_.vectorFromOpen(hit.dpdu, hit.time);
+	hit.dpdv = motion_.vectorFromOpen(hit.dpdv, hit.time);
+}
+
+/**
+* Bounds covering the whole shutter interval, for the BVH. A ray at any
+* time is tested against the same box, so the cost of tracing does not
+* depend on how the motion is sampled.
+*/
+AABB SceneObject::sweptBounds()
+{
+	if (!moving_) return getBounds();
+	return motion_.sweep(getBounds());
+}
+
+void SceneObject::setMotion(glm::vec3 shift)
+{
+	setMotion(shift, glm::vec3(0), glm::vec3(0, 1, 0), 0);
+}
+
+void SceneObject::setMotion(glm::vec3 shift, glm::vec3 pivot, glm::vec3 axis, float angle)
+{
+	motion_.shift = shift;
+	motion_.pivot = pivot;
+	motion_.axis = glm::normalize(axis);
+	motion_.angle = angle;
+	moving_ = motion_.isMoving();
+}
+
+bool SceneObject::isMoving()
+{
+	return moving_;
+}
 
 glm::vec3 SceneObject::getColor()
 {
 	return color_;
 }
 
-glm::vec3 SceneObject::lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit)
+/**
+* Fills in the surface details of a hit whose position is already set.
+* Objects without a texture mapping get zero texture coordinates and an
+* arbitrary tangent frame around the normal.
+*/
+void SceneObject::fillHit(HitRecord& hit)
 {
-	float ambientTerm = 0.2;
-	float diffuseTerm = 0;
-	float specularTerm = 0;
-	glm::vec3 normalVec = normal(hit);
-	glm::vec3 lightVec = lightPos - hit;
-	lightVec = glm::normalize(lightVec);
-	float lDotn = glm::dot(lightVec, normalVec);
-	if (spec_)
+	hit.normal = normal(hit.position);
+	hit.shadingNormal = hit.normal;
+	hit.uv = glm::vec2(0);
+
+	glm::vec3 tangent = glm::cross(hit.normal, glm::vec3(0, 1, 0));
+	if (glm::length(tangent) == 0.0f)
 	{
-		glm::vec3 reflVec = glm::reflect(-lightVec, normalVec);
-		float rDotv = glm::dot(reflVec, viewVec);
-		if (rDotv > 0) specularTerm = pow(rDotv, shin_);
+		tangent = glm::cross(hit.normal, glm::vec3(0, 0, 1));
 	}
-	glm::vec3 colorSum = ambientTerm * color_ + lDotn * color_ + specularTerm * glm::vec3(1);
-	return colorSum;
-}
-glm::vec3 SceneObject::lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit, glm::vec3 color)
-{
-	float ambientTerm = 0.2;
-	float diffuseTerm = 0;
-	float specularTerm = 0;
-	glm::vec3 normalVec = normal(hit);
-	glm::vec3 lightVec = lightPos - hit;
-	lightVec = glm::normalize(lightVec);
-	float lDotn = glm::dot(lightVec, normalVec);
-	if (spec_)
+	hit.dpdu = glm::normalize(tangent);
+	hit.dpdv = glm::normalize(glm::cross(hit.normal, hit.dpdu));
+}
+
+/**
+* Phong lighting summed over the light samples gathered for this hit.
+* Each sample's intensity already accounts for shadowing, so occluded
+* lights only leave the ambient term behind.
+* The loop body has no early exits: lights facing away are masked out
+* instead, so the compiler can run it over several lights at once. The
+* reflected vector is never formed, since R.V = 2(L.N)(N.V) - L.V.
+*/
+glm::vec3 SceneObject::lighting(const HitRecord& hit, const LightSample* lights, int numLights, glm::vec3 viewVec, glm::vec3 color)
+{
+	float ambientTerm = 0.2f;
+	glm::vec3 normalVec = hit.shadingNormal;
+	float nDotv = glm::dot(normalVec, viewVec);
+	glm::vec3 diffuseSum(0);
+	glm::vec3 specularSum(0);
+	for (int i = 0; i < numLights; i++)
 	{
-		glm::vec3 reflVec = glm::reflect(-lightVec, normalVec);
-		float rDotv = glm::dot(reflVec, viewVec);
-		if (rDotv > 0) specularTerm = pow(rDotv, shin_);
+		glm::vec3 lightVec = lights[i].position - hit.position;
+		lightVec *= 1.0f / sqrtf(glm::dot(lightVec, lightVec));
+		float lDotn = glm::dot(lightVec, normalVec);
+		float rDotv = 2.0f * lDotn * nDotv - glm::dot(lightVec, viewVec);
+		float lit = lDotn > 0 ? 1.0f : 0.0f;
+		float specularTerm = (spec_ && rDotv > 0) ? specular(rDotv) : 0.0f;
+		diffuseSum += (lit * lDotn) * lights[i].intensity;
+		specularSum += (lit * specularTerm) * lights[i].intensity;
 	}
-	glm::vec3 colorSum = ambientTerm * color + lDotn * color + specularTerm * glm::vec3(1);
-	return colorSum;
+	return ambientTerm * color + diffuseSum * color + specularSum;
+}
+
+/**
+* rDotv raised to the shininess, read from the table with linear
+* interpolation instead of calling pow().
+*/
+float SceneObject::specular(float rDotv)
+{
+	float x = fminf(rDotv, 1.0f) * SPECULAR_LUT_SIZE;
+	int i = (int)x;
+	if (i >= SPECULAR_LUT_SIZE) return specularLut_[SPECULAR_LUT_SIZE];
+	float frac = x - i;
+	return specularLut_[i] + frac * (specularLut_[i + 1] - specularLut_[i]);
 }
 
-glm::vec3 SceneObject::normal(glm::vec3 pos, glm::vec3 normalMap)
+/**
+* Perturbs the hit's normal by a normal map texel, using the hit's tangents.
+*/
+glm::vec3 SceneObject::normal(const HitRecord& hit, glm::vec3 normalMap)
 {
 	// normal map logic retrieved from:
 	// https://stackoverflow.com/questions/41015574/raytracing-normal-mapping
-	glm::vec3 normalHit = normal(pos);
-	glm::vec3 tangent = glm::cross(normalHit, glm::vec3(0, 1, 0));
-	if (glm::length(tangent) == 0.0f)
-	{
-		tangent = glm::cross(normalHit, glm::vec3(0, 0, 1));
-	}
-	tangent = glm::normalize(tangent);
-	glm::vec3 bitangent = glm::normalize(glm::cross(normalHit, tangent));
-
 	glm::vec3 modifiedMap = normalMap * 2.0f - glm::vec3(1);
-	glm::mat3 tbn(tangent, bitangent, normalHit);
+	glm::mat3 tbn(hit.dpdu, hit.dpdv, hit.normal);
 	glm::vec3 normalVec = glm::normalize(tbn * modifiedMap);
 
 	return normalVec;
 }
 
-glm::vec3 SceneObject::lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit, glm::vec3 color, glm::vec3 normalMap)
-{
-	float ambientTerm = 0.2;
-	float diffuseTerm = 0;
-	float specularTerm = 0;
-	glm::vec3 normalVec = normal(hit, normalMap);
-	glm::vec3 lightVec = lightPos - hit;
-	lightVec = glm::normalize(lightVec);
-	float lDotn = glm::dot(lightVec, normalVec);
-	if (spec_)
-	{
-		glm::vec3 reflVec = glm::reflect(-lightVec, normalVec);
-		float rDotv = glm::dot(reflVec, viewVec);
-		if (rDotv > 0) specularTerm = pow(rDotv, shin_);
-	}
-	glm::vec3 colorSum = ambientTerm * color + lDotn * color + specularTerm * glm::vec3(1);
-	return colorSum;
-}
-
 float SceneObject::getReflectionCoeff()
 {
 	return reflc_;
@@ -170,9 +261,31 @@ void SceneObject::setRefractivity(bool flag, float refr_coeff, float refr_index)
 	refri_ = refr_index;
 }
 
+/**
+* The specular table for a shininess, built the first time it is asked for.
+* Tables are never changed or freed once built, so objects can keep a pointer.
+*/
+static const float* specularTable(float shininess)
+{
+	static std::mutex lock;
+	static std::map<float, std::vector<float>> tables;
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<float>& table = tables[shininess];
+	if (table.empty())
+	{
+		table.resize(SPECULAR_LUT_SIZE + 1);
+		for (int i = 0; i <= SPECULAR_LUT_SIZE; i++)
+		{
+			table[i] = powf((float)i / SPECULAR_LUT_SIZE, shininess);
+		}
+	}
+	return table.data();
+}
+
 void SceneObject::setShininess(float shininess)
 {
 	shin_ = shininess;
+	specularLut_ = specularTable(shin_);
 }
 
 void SceneObject::setSpecularity(bool flag)
@@ -7,21 +7,45 @@
 *  Being an abstract class, this class cannot be instantiated.
 *  Sphere, Plane etc, must be defined as subclasses of Object
 *      and provide implementations for the virtual functions
-*      intersect()  and normal().
+*      intersect(), normal() and getBounds(). Solids with a
+*      cheap closed form also override interval().
+*  Any object can be given a Motion over the shutter interval;
+*      the ...At() functions then move the ray to where the
+*      object was when the shutter opened, so subclasses only
+*      ever deal with a still object.
 -------------------------------------------------------------*/
 
 #ifndef H_SOBJECT
 #define H_SOBJECT
 #include <glm/glm.hpp>
+#include "AABB.h"
+#include "HitRecord.h"
+#include "Light.h"
+#include "Motion.h"
 
 typedef enum ObjectType {
 	GenericObject,
 	SphereObject,
 	PlaneObject,
 	TorusObject,
-	CylinderObject
+	CylinderObject,
+	GroupObject,
+	InstanceObject,
+	BoxObject,
+	QuadricObject
 } ObjectType;
 
+#define SPECULAR_LUT_SIZE 1024
+
+// Float-only intersection kernels with one sqrt per root pair, and unit
+// directions passed to rays without normalizing them again.
+// Build with -DFAST_MATH_KERNELS=0 to use the original code paths; the
+// original sphere and cylinder kernels stay callable as intersectReference()
+// and are compared with the fast ones by checks/KernelCheck.cpp.
+#ifndef FAST_MATH_KERNELS
+#define FAST_MATH_KERNELS 1
+#endif
+
 class SceneObject 
 {
 protected:
@@ -35,17 +59,36 @@ protected:
 	float tranc_ = 0.8;  //coefficient of transparency
 	float refri_ = 1.0;  //refractive index
 	float shin_ = 50.0; //shininess
+	const float* specularLut_;  //x^shin_ sampled over [0, 1], shared by all objects of that shininess
 	ObjectType type_ = GenericObject;
+	Motion motion_;		//Movement while the shutter is open
+	bool moving_ = false;
 public:
-	SceneObject() {}
+	SceneObject() { setShininess(shin_); }
     virtual float intersect(glm::vec3 p0, glm::vec3 dir) = 0;
 	virtual glm::vec3 normal(glm::vec3 pos) = 0;
+	virtual AABB getBounds() = 0;
+	virtual bool interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar);
+	virtual void fillHit(HitRecord& hit);
 	virtual ~SceneObject() {}
 
-	glm::vec3 lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit);
-	glm::vec3 lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit, glm::vec3 color);
-	glm::vec3 lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit, glm::vec3 color, glm::vec3 normalMap);
-	glm::vec3 normal(glm::vec3 pos, glm::vec3 normalMap);
+	// intersect() against the object where it is at shutter time 'time', 0 (open) to 1 (closed)
+	float intersectAt(glm::vec3 p0, glm::vec3 dir, float time)
+	{
+		if (!moving_) return intersect(p0, dir);
+		return intersect(motion_.pointToOpen(p0, time), motion_.vectorToOpen(dir, time));
+	}
+	bool intervalAt(glm::vec3 p0, glm::vec3 dir, float time, float& tNear, float& tFar);
+	glm::vec3 normalAt(glm::vec3 pos, float time);
+	void fillHitAt(HitRecord& hit);
+	AABB sweptBounds();
+	void setMotion(glm::vec3 shift);
+	void setMotion(glm::vec3 shift, glm::vec3 pivot, glm::vec3 axis, float angle);
+	bool isMoving();
+
+	glm::vec3 lighting(const HitRecord& hit, const LightSample* lights, int numLights, glm::vec3 viewVec, glm::vec3 color);
+	float specular(float rDotv);
+	glm::vec3 normal(const HitRecord& hit, glm::vec3 normalMap);
 	void setColor(glm::vec3 col);
 	void setReflectivity(bool flag);
 	void setReflectivity(bool flag, float refl_coeff);
@@ -0,0 +1,70 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The solid texture class
+*  Procedural 3D textures evaluated directly at a point in an
+*  object's local space.
+-------------------------------------------------------------*/
+
+#include "SolidTexture.h"
+#include "Noise.h"
+#include <math.h>
+
+/**
+* Number of octaves worth evaluating for a pixel covering 'footprint' units
+* on the surface. Octave i has 2^i * scale lattice cells per unit, and
+* octaves above half a cell per footprint would only alias, so they are
+* dropped. The result is fractional so detail fades out smoothly with distance.
+* A footprint of 0 means unknown, and gives every octave.
+*/
+float SolidTexture::getOctaves(float footprint)
+{
+	if (footprint <= 0) return maxOctaves_;
+	float octaves = log2(0.5f / (scale_ * footprint)) + 1;
+	if (octaves < 1) return 1;
+	if (octaves > maxOctaves_) return maxOctaves_;
+	return octaves;
+}
+
+/**
+* Texture value in [0,1] at local point p.
+*/
+float SolidTexture::getValueAt(glm::vec3 p, float footprint)
+{
+	glm::vec3 q = p * scale_;
+	float octaves = getOctaves(footprint);
+
+	switch (type_)
+	{
+	case TurbulenceSolid:
+		return glm::clamp(turbulence3(q.x, q.y, q.z, octaves, seed_), 0.0f, 1.0f);
+	case MarbleSolid:
+	{
+		float turb = turbulence3(q.x, q.y, q.z, octaves, seed_);
+		return fabs(sin((p.y * period_ + turbPower_ * turb) * M_PI));
+	}
+	case WoodSolid:
+	{
+		float turb = turbulence3(q.x, q.y, q.z, octaves, seed_);
+		float rings = sqrt(p.x * p.x + p.z * p.z) * period_ + turbPower_ * turb;
+		return rings - floor(rings);
+	}
+	default:
+		return glm::clamp(0.5f + 0.5f * fbm3(q.x, q.y, q.z, octaves, seed_), 0.0f, 1.0f);
+	}
+}
+
+void SolidTexture::setMaxOctaves(int octaves)
+{
+	maxOctaves_ = octaves;
+}
+
+void SolidTexture::setPeriod(float period)
+{
+	period_ = period;
+}
+
+void SolidTexture::setTurbulence(float power)
+{
+	turbPower_ = power;
+}
@@ -0,0 +1,44 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The solid texture class
+*  Procedural 3D textures evaluated directly at a point in an
+*  object's local space, so there is no lookup table to store
+*  and no (s, t) mapping to stretch at poles or tear at seams.
+-------------------------------------------------------------*/
+
+#ifndef H_SOLIDTEXTURE
+#define H_SOLIDTEXTURE
+#include <glm/glm.hpp>
+
+typedef enum SolidTextureType {
+	FbmSolid,
+	TurbulenceSolid,
+	MarbleSolid,
+	WoodSolid
+} SolidTextureType;
+
+class SolidTexture
+{
+private:
+	SolidTextureType type_ = FbmSolid;
+	float scale_ = 1.0;			//noise lattice cells per unit length
+	float period_ = 1.0;		//marble veins / wood rings per unit length
+	float turbPower_ = 1.0;		//how far turbulence pushes veins and rings
+	int maxOctaves_ = 6;
+	unsigned int seed_ = 0;
+
+public:
+	SolidTexture() {}
+
+	SolidTexture(SolidTextureType type, float scale, unsigned int seed) :
+		type_(type), scale_(scale), seed_(seed) {}
+
+	float getValueAt(glm::vec3 p, float footprint);
+	float getOctaves(float footprint);
+	void setMaxOctaves(int octaves);
+	void setPeriod(float period);
+	void setTurbulence(float power);
+};
+
+#endif //!H_SOLIDTEXTURE
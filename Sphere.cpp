@@ -9,10 +9,35 @@
 #include "Sphere.h"
 #include <math.h>
 
+// The nearer root in front of the ray, or -1.0 if neither is.
+static float nearestRoot(float t1, float t2)
+{
+    if(fabs(t1) < 0.001 )
+    {
+        if (t2 > 0) return t2;
+        else t1 = -1.0;
+    }
+    if(fabs(t2) < 0.001 ) t2 = -1.0;
+
+	return (t1 < t2)? t1: t2;
+}
+
 /**
 * Sphere's intersection method.  The input is a ray. 
 */
 float Sphere::intersect(glm::vec3 p0, glm::vec3 dir)
+{
+#if FAST_MATH_KERNELS
+    return intersectFast(p0, dir);
+#else
+    return intersectReference(p0, dir);
+#endif
+}
+
+/**
+* The original kernel, kept to check intersectFast() against.
+*/
+float Sphere::intersectReference(glm::vec3 p0, glm::vec3 dir)
 {
     glm::vec3 vdif = p0 - center;   //Vector s (see Slide 28)
     float b = glm::dot(dir, vdif);
@@ -25,14 +50,40 @@ float Sphere::intersect(glm::vec3 p0, glm::vec3 dir)
 
     float t1 = -b - sqrt(delta);
     float t2 = -b + sqrt(delta);
-    if(fabs(t1) < 0.001 )
-    {
-        if (t2 > 0) return t2;
-        else t1 = -1.0;
-    }
-    if(fabs(t2) < 0.001 ) t2 = -1.0;
+    return nearestRoot(t1, t2);
+}
 
-	return (t1 < t2)? t1: t2;
+/**
+* |s|^2 from a dot product, one sqrtf, and the grazing and no-hit tests
+* folded into one comparison.
+*/
+float Sphere::intersectFast(glm::vec3 p0, glm::vec3 dir)
+{
+    glm::vec3 vdif = p0 - center;
+    float b = glm::dot(dir, vdif);
+    float c = glm::dot(vdif, vdif) - radius*radius;
+    float delta = b*b - c;
+    if(delta < 0.001f) return -1.0f;
+
+    float root = sqrtf(delta);
+    return nearestRoot(-b - root, -b + root);
+}
+
+/**
+* Both roots at once: where the ray's line enters and leaves the sphere.
+*/
+bool Sphere::interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar)
+{
+    glm::vec3 vdif = p0 - center;
+    float b = glm::dot(dir, vdif);
+    float c = glm::dot(vdif, vdif) - radius*radius;
+    float delta = b*b - c;
+    if(delta < 0.001) return false;
+
+    float root = sqrt(delta);
+    tNear = -b - root;
+    tFar = -b + root;
+    return tFar > 0.001;
 }
 
 /**
@@ -45,3 +96,34 @@ glm::vec3 Sphere::normal(glm::vec3 p)
     n = glm::normalize(n);
     return n;
 }
+
+/**
+* Spherical texture coordinates, with u running around the y axis and v
+* from the top pole down. The tangents follow the same parameterization;
+* only at the poles, where u is undefined, is the generic frame used.
+*/
+void Sphere::fillHit(HitRecord& hit)
+{
+    glm::vec3 n = normal(hit.position);
+    float ring = sqrt(n.x*n.x + n.z*n.z);
+    if (ring < 1.e-6)
+    {
+        SceneObject::fillHit(hit);
+    }
+    else
+    {
+        hit.normal = n;
+        hit.shadingNormal = n;
+        hit.dpdu = glm::vec3(n.z, 0, -n.x) / ring;
+        hit.dpdv = glm::cross(hit.dpdu, n);
+    }
+    hit.uv = glm::vec2(0.5 + atan2(n.x, n.z) / (2 * M_PI), 0.5 - asin(n.y) / M_PI);
+}
+
+/**
+* Axis-aligned box enclosing the sphere.
+*/
+AABB Sphere::getBounds()
+{
+    return AABB(center - glm::vec3(radius), center + glm::vec3(radius));
+}
@@ -29,8 +29,22 @@ public:
 
 	float intersect(glm::vec3 p0, glm::vec3 dir);
 
+	float intersectReference(glm::vec3 p0, glm::vec3 dir);
+
+	float intersectFast(glm::vec3 p0, glm::vec3 dir);
+
+	bool interval(glm::vec3 p0, glm::vec3 dir, float& tNear, float& tFar);
+
 	glm::vec3 normal(glm::vec3 p);
 
+	void fillHit(HitRecord& hit);
+
+	AABB getBounds();
+
+	glm::vec3 getCenter() { return center; }
+
+	void setCenter(glm::vec3 c) { center = c; }
+
 };
 
 #endif //!H_SPHERE
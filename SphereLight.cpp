@@ -0,0 +1,31 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The spherical area light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#include "SphereLight.h"
+#include <math.h>
+
+/**
+* Samples the disc the sphere covers when seen from 'from'.
+* Only the silhouette matters for shadows, and sampling the disc keeps
+* every sample on the side of the light facing the shading point.
+*/
+glm::vec3 SphereLight::samplePoint(glm::vec3 from, float u, float v)
+{
+	glm::vec3 w = from - center;
+	float len = glm::length(w);
+	if (len < radius) return center;
+	w = w / len;
+
+	glm::vec3 axis = (fabs(w.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+	glm::vec3 tangent = glm::normalize(glm::cross(axis, w));
+	glm::vec3 bitangent = glm::cross(w, tangent);
+
+	float r = radius * sqrt(u);
+	float phi = 2.0f * M_PI * v;
+	return center + r * (cos(phi) * tangent + sin(phi) * bitangent);
+}
@@ -0,0 +1,34 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  The spherical area light class
+*  This is a subclass of Light, and hence implements the
+*  method samplePoint().
+-------------------------------------------------------------*/
+
+#ifndef H_SPHERELIGHT
+#define H_SPHERELIGHT
+#include <glm/glm.hpp>
+#include "Light.h"
+
+/**
+ * Defines a spherical light located at 'center'
+ * with the specified radius
+ */
+class SphereLight : public Light
+{
+
+private:
+	glm::vec3 center = glm::vec3(0);
+	float radius = 1;
+
+public:
+	SphereLight() { this->type_ = SphereLightType; }
+
+	SphereLight(glm::vec3 c, float r) : center(c), radius(r) { this->type_ = SphereLightType; }
+
+	glm::vec3 samplePoint(glm::vec3 from, float u, float v);
+
+};
+
+#endif //!H_SPHERELIGHT
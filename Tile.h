@@ -0,0 +1,56 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Tiles of the frame
+*  The unit of work handed to render threads, worker
+*  processes and the checkpoint file.
+-------------------------------------------------------------*/
+
+#ifndef H_TILE
+#define H_TILE
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * The cells [x0, x1) x [y0, y1) of the frame. Tile colours are stored
+ * column by column: cell (x, y) is at (x - x0) * (y1 - y0) + (y - y0).
+ */
+struct Tile
+{
+	int x0, x1, y0, y1;
+
+	int numCells() const { return (x1 - x0) * (y1 - y0); }
+};
+
+/**
+ * Cuts region into tiles of tileSize cells, aligned to the frame's tile
+ * grid and numbered column by column. Tiles on the region's edge are cut
+ * down to fit inside it.
+ */
+inline std::vector<Tile> regionTiles(const Tile& region, int tileSize)
+{
+	std::vector<Tile> tiles;
+	for (int x = region.x0 - region.x0 % tileSize; x < region.x1; x += tileSize)
+	{
+		for (int y = region.y0 - region.y0 % tileSize; y < region.y1; y += tileSize)
+		{
+			tiles.push_back({ std::max(x, region.x0), std::min(x + tileSize, region.x1),
+				std::max(y, region.y0), std::min(y + tileSize, region.y1) });
+		}
+	}
+	return tiles;
+}
+
+// The position of tile in regionTiles(region, tileSize)
+inline int regionTileIndex(const Tile& region, const Tile& tile, int tileSize)
+{
+	int tilesPerColumn = (region.y1 - 1) / tileSize - region.y0 / tileSize + 1;
+	return (tile.x0 / tileSize - region.x0 / tileSize) * tilesPerColumn + tile.y0 / tileSize - region.y0 / tileSize;
+}
+
+typedef std::function<void(const Tile&, const glm::vec3*)> TileSink;
+typedef std::function<void(const Tile&, glm::vec3*)> TileRenderer;
+
+#endif //!H_TILE
@@ -44,7 +44,7 @@ float Torus::intersect(glm::vec3 p0, glm::vec3 dir)
     int numSolutions = SolveQuartic(coeffs, solutions);
     float min = INFINITY;
     if (numSolutions == 0) return -1.0;
-    for (int i = 0; i < 4; i++)
+    for (int i = 0; i < numSolutions; i++)
     {
         double t = solutions[i];
         if (t > 0.001 && t < min)
@@ -77,3 +77,13 @@ glm::vec3 Torus::normal(glm::vec3 p)
     n = glm::normalize(n);
     return n;
 }
+
+/**
+* Axis-aligned box enclosing the torus, which lies in the xz plane.
+*/
+AABB Torus::getBounds()
+{
+    float outer = majorRadius + minorRadius;
+    return AABB(center - glm::vec3(outer, minorRadius, outer),
+        center + glm::vec3(outer, minorRadius, outer));
+}
@@ -32,6 +32,8 @@ public:
 
 	glm::vec3 normal(glm::vec3 p);
 
+	AABB getBounds();
+
 };
 
 #endif //H_TORUS
\ No newline at end of file
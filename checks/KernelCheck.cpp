@@ -0,0 +1,159 @@
+/*----------------------------------------------------------
+* COSC363  Ray Tracer
+*
+*  Differential check of the fast intersection kernels
+*  Fires random rays at random spheres and cylinders and
+*  compares intersectFast() with intersectReference(): both
+*  must agree on hit or miss, and on t to within a small
+*  relative tolerance. Rays that graze a surface, or whose
+*  hit lies near a cylinder's rim or the 0.001 self-hit
+*  cutoff, are skipped, since there either answer is right.
+*
+*  Build from the top of the tree, like the app:
+*    g++ -O2 -I. checks/KernelCheck.cpp Sphere.cpp Cylinder.cpp
+*        SceneObject.cpp -o kernelcheck
+*  Exits with 1 if any ray disagrees.
+-------------------------------------------------------------*/
+
+#include <iostream>
+#include <math.h>
+#include <random>
+#include <glm/glm.hpp>
+#include "Cylinder.h"
+#include "Sphere.h"
+
+using namespace std;
+
+#define NUM_RAYS 1000000
+#define T_TOLERANCE 1.e-3f		//Relative to max(t, 1)
+#define GRAZING_MARGIN 1.e-2	//Skipped discriminants, relative to radius^2...
+#define ROUNDING_MARGIN 1.e-5	//...or to b^2, whose float rounding they cancel against
+#define EDGE_MARGIN 1.e-2f		//Skipped distances from a rim or the self-hit cutoff
+
+mt19937 rng(363);
+
+float uniform(float lo, float hi)
+{
+	return uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+glm::vec3 randomPoint(float extent)
+{
+	return glm::vec3(uniform(-extent, extent), uniform(-extent, extent), uniform(-extent, extent));
+}
+
+// A unit direction from p0 towards target, jittered so that about half the rays miss
+glm::vec3 aimAt(glm::vec3 p0, glm::vec3 target, float spread)
+{
+	return glm::normalize(target + randomPoint(spread) - p0);
+}
+
+struct Tally
+{
+	const char *name;
+	int compared = 0, skipped = 0, hits = 0, failures = 0;
+
+	void check(float fast, float reference, glm::vec3 p0, glm::vec3 dir)
+	{
+		compared++;
+		bool fastHit = fast > 0, referenceHit = reference > 0;
+		if (referenceHit) hits++;
+		bool ok = fastHit == referenceHit
+			&& (!fastHit || fabs(fast - reference) <= T_TOLERANCE * fmax(reference, 1.0f));
+		if (ok) return;
+		if (failures++ < 10)
+		{
+			cerr << name << " mismatch: fast " << fast << ", reference " << reference << ", ray ("
+				<< p0.x << ", " << p0.y << ", " << p0.z << ") + t (" << dir.x << ", " << dir.y << ", " << dir.z << ")" << endl;
+		}
+	}
+
+	void report()
+	{
+		cout << name << ": " << compared << " rays compared (" << hits << " hits), " << skipped
+			<< " grazing skipped, " << failures << " mismatches" << endl;
+	}
+};
+
+// Whether t, a root of either kernel, is too close to the self-hit cutoff to call
+bool nearCutoff(double t)
+{
+	return t != -1.0 && fabs(fabs(t) - 0.001) < EDGE_MARGIN;
+}
+
+// Whether a discriminant is too close to zero for float kernels to agree on
+bool grazing(double delta, double bSquared, double scale)
+{
+	return fabs(delta) < fmax(GRAZING_MARGIN * scale, ROUNDING_MARGIN * bSquared);
+}
+
+void checkSpheres(Tally& tally)
+{
+	for (int i = 0; i < NUM_RAYS; i++)
+	{
+		glm::vec3 center = randomPoint(50);
+		float radius = uniform(0.5f, 20);
+		Sphere sphere(center, radius);
+		glm::vec3 p0 = randomPoint(100);
+		glm::vec3 dir = aimAt(p0, center, 2 * radius);
+
+		double sx = (double)p0.x - center.x, sy = (double)p0.y - center.y, sz = (double)p0.z - center.z;
+		double b = dir.x * sx + dir.y * sy + dir.z * sz;
+		double delta = b * b - (sx * sx + sy * sy + sz * sz - (double)radius * radius);
+		double root = sqrt(fmax(delta, 0.0));
+		if (grazing(delta, b * b, radius * radius) || nearCutoff(-b - root) || nearCutoff(-b + root))
+		{
+			tally.skipped++;
+			continue;
+		}
+		tally.check(sphere.intersectFast(p0, dir), sphere.intersectReference(p0, dir), p0, dir);
+	}
+}
+
+void checkCylinders(Tally& tally)
+{
+	for (int i = 0; i < NUM_RAYS; i++)
+	{
+		glm::vec3 center = randomPoint(50);
+		float radius = uniform(0.5f, 20);
+		float height = uniform(0.5f, 40);
+		Cylinder cylinder(center, radius, height);
+		glm::vec3 p0 = randomPoint(100);
+		glm::vec3 dir = aimAt(p0, center + glm::vec3(0, height / 2, 0), 2 * radius + height);
+
+		double sx = (double)p0.x - center.x, sy = (double)p0.y - center.y, sz = (double)p0.z - center.z;
+		double a = (double)dir.x * dir.x + (double)dir.z * dir.z;
+		double b = dir.x * sx + dir.z * sz;
+		double delta = b * b - a * (sx * sx + sz * sz - (double)radius * radius);
+		bool skip = a < 1.e-4 || grazing(delta, b * b, a * radius * radius);
+		if (!skip)
+		{
+			double root = sqrt(fmax(delta, 0.0));
+			double roots[2] = { (-b - root) / a, (-b + root) / a };
+			for (int k = 0; k < 2; k++)
+			{
+				double y = sy + roots[k] * dir.y;
+				if (nearCutoff(roots[k]) || fabs(y) < EDGE_MARGIN * height
+					|| fabs(y - height) < EDGE_MARGIN * height) skip = true;
+			}
+		}
+		if (skip)
+		{
+			tally.skipped++;
+			continue;
+		}
+		tally.check(cylinder.intersectFast(p0, dir), cylinder.intersectReference(p0, dir), p0, dir);
+	}
+}
+
+int main()
+{
+	Tally spheres, cylinders;
+	spheres.name = "Sphere";
+	cylinders.name = "Cylinder";
+	checkSpheres(spheres);
+	checkCylinders(cylinders);
+	spheres.report();
+	cylinders.report();
+	return spheres.failures + cylinders.failures > 0 ? 1 : 0;
+}